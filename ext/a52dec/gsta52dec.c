@@ -50,6 +50,7 @@
 #  include <a52dec/mm_accel.h>
 #endif
 #include "gsta52dec.h"
+#include "gsta52interleave.h"
 
 #if HAVE_ORC
 #include <orc/orc.h>
@@ -75,8 +76,12 @@ enum
   ARG_DRC,
   ARG_MODE,
   ARG_LFE,
+  ARG_PASSTHROUGH,
+  ARG_OUTPUT_FRAMES,
 };
 
+#define DEFAULT_OUTPUT_FRAMES 1
+
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -89,6 +94,9 @@ static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("audio/x-raw, "
         "format = (string) " SAMPLE_FORMAT ", "
         "layout = (string) interleaved, "
+        "rate = (int) [ 4000, 96000 ], " "channels = (int) [ 1, 6 ]; "
+        "audio/x-ac3, "
+        "framed = (boolean) true, "
         "rate = (int) [ 4000, 96000 ], " "channels = (int) [ 1, 6 ]")
     );
 
@@ -100,6 +108,7 @@ GST_ELEMENT_REGISTER_DEFINE_CUSTOM (a52dec, a52_element_init);
 
 static gboolean gst_a52dec_start (GstAudioDecoder * dec);
 static gboolean gst_a52dec_stop (GstAudioDecoder * dec);
+static void gst_a52dec_flush (GstAudioDecoder * dec, gboolean hard);
 static gboolean gst_a52dec_set_format (GstAudioDecoder * bdec, GstCaps * caps);
 static GstFlowReturn gst_a52dec_parse (GstAudioDecoder * dec,
     GstAdapter * adapter, gint * offset, gint * length);
@@ -153,6 +162,7 @@ gst_a52dec_class_init (GstA52DecClass * klass)
 
   gstbase_class->start = GST_DEBUG_FUNCPTR (gst_a52dec_start);
   gstbase_class->stop = GST_DEBUG_FUNCPTR (gst_a52dec_stop);
+  gstbase_class->flush = GST_DEBUG_FUNCPTR (gst_a52dec_flush);
   gstbase_class->set_format = GST_DEBUG_FUNCPTR (gst_a52dec_set_format);
   gstbase_class->parse = GST_DEBUG_FUNCPTR (gst_a52dec_parse);
   gstbase_class->handle_frame = GST_DEBUG_FUNCPTR (gst_a52dec_handle_frame);
@@ -188,6 +198,36 @@ gst_a52dec_class_init (GstA52DecClass * klass)
   g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_LFE,
       g_param_spec_boolean ("lfe", "LFE", "LFE", TRUE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstA52Dec:passthrough
+   *
+   * Do not decode, but pass the parsed AC-3 frames on as framed
+   * audio/x-ac3 for receivers that decode AC-3 themselves. Audio sinks that
+   * support S/PDIF or HDMI passthrough wrap them into IEC 61937 bursts.
+   *
+   * Passthrough is also used when downstream does not accept decoded audio
+   * at all, regardless of this property.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_PASSTHROUGH,
+      g_param_spec_boolean ("passthrough", "Passthrough",
+          "Output the AC-3 frames instead of decoded audio", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstA52Dec:output-frames
+   *
+   * Number of decoded frames to collect into one output buffer. A frame
+   * holds 1536 samples, so larger values save per-buffer overhead
+   * downstream at the expense of latency, which is reported as
+   * output-frames - 1 frames.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_OUTPUT_FRAMES,
+      g_param_spec_uint ("output-frames", "Output Frames",
+          "Number of decoded frames per output buffer", 1, 32,
+          DEFAULT_OUTPUT_FRAMES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
@@ -229,6 +269,8 @@ gst_a52dec_init (GstA52Dec * a52dec)
 {
   a52dec->request_channels = A52_CHANNEL;
   a52dec->dynamic_range_compression = FALSE;
+  a52dec->passthrough = FALSE;
+  a52dec->output_frames = DEFAULT_OUTPUT_FRAMES;
 
   a52dec->state = NULL;
   a52dec->samples = NULL;
@@ -279,6 +321,14 @@ gst_a52dec_start (GstAudioDecoder * dec)
   a52dec->level = 1;
   a52dec->bias = 0;
   a52dec->flag_update = TRUE;
+  a52dec->synced = FALSE;
+  a52dec->passthrough_active = FALSE;
+  a52dec->downstream_ac3 = FALSE;
+  a52dec->downstream_checked = FALSE;
+  a52dec->pending = NULL;
+  a52dec->pending_frames = 0;
+  a52dec->pending_max = 1;
+  a52dec->latency = 0;
 
   /* call upon legacy upstream byte support (e.g. seeking) */
   gst_audio_decoder_set_estimate_rate (dec, TRUE);
@@ -293,6 +343,14 @@ gst_a52dec_stop (GstAudioDecoder * dec)
 
   GST_DEBUG_OBJECT (dec, "stop");
 
+  gst_buffer_replace (&a52dec->pending, NULL);
+  a52dec->pending_frames = 0;
+  if (a52dec->pool) {
+    gst_buffer_pool_set_active (a52dec->pool, FALSE);
+    gst_object_unref (a52dec->pool);
+    a52dec->pool = NULL;
+  }
+
   a52dec->samples = NULL;
   if (a52dec->state) {
     a52_free (a52dec->state);
@@ -302,6 +360,17 @@ gst_a52dec_stop (GstAudioDecoder * dec)
   return TRUE;
 }
 
+static void
+gst_a52dec_flush (GstAudioDecoder * dec, gboolean hard)
+{
+  GstA52Dec *a52dec = GST_A52DEC (dec);
+
+  GST_DEBUG_OBJECT (dec, "flush");
+
+  gst_buffer_replace (&a52dec->pending, NULL);
+  a52dec->pending_frames = 0;
+}
+
 static GstFlowReturn
 gst_a52dec_parse (GstAudioDecoder * bdec, GstAdapter * adapter,
     gint * _offset, gint * len)
@@ -311,9 +380,15 @@ gst_a52dec_parse (GstAudioDecoder * bdec, GstAdapter * adapter,
   gint av, size;
   gint length = 0, flags, sample_rate, bit_rate;
   GstFlowReturn result = GST_FLOW_EOS;
+  gboolean sync, eos;
 
   a52dec = GST_A52DEC (bdec);
 
+  /* discontinuities (e.g. after a seek) call for verifying sync again */
+  gst_audio_decoder_get_parse_state (bdec, &sync, &eos);
+  if (!sync)
+    a52dec->synced = FALSE;
+
   size = av = gst_adapter_available (adapter);
   data = (const guint8 *) gst_adapter_map (adapter, av);
 
@@ -322,21 +397,63 @@ gst_a52dec_parse (GstAudioDecoder * bdec, GstAdapter * adapter,
   sample_rate = a52dec->sample_rate;
   flags = 0;
   while (size >= 7) {
+    /* when in sync, the previous frame length predicts where the next sync
+     * word is, which is at the start of the adapter */
+    if (data[0] != 0x0b || data[1] != 0x77) {
+      const guint8 *next;
+
+      if (a52dec->synced) {
+        GST_DEBUG_OBJECT (a52dec, "Lost sync");
+        a52dec->synced = FALSE;
+      }
+
+      /* skip straight to the next possible sync word */
+      next = memchr (data + 1, 0x0b, size - 1);
+      if (next == NULL) {
+        data += size;
+        size = 0;
+        break;
+      }
+      size -= next - data;
+      data = next;
+      continue;
+    }
+
     length = a52_syncinfo ((guint8 *) data, &flags, &sample_rate, &bit_rate);
 
     if (length == 0) {
       /* shift window to re-find sync */
+      a52dec->synced = FALSE;
       data++;
       size--;
-    } else if (length <= size) {
-      GST_LOG_OBJECT (a52dec, "Sync: frame size %d", length);
-      result = GST_FLOW_OK;
-      break;
-    } else {
+      continue;
+    } else if (length > size) {
       GST_LOG_OBJECT (a52dec, "Not enough data available (needed %d had %d)",
           length, size);
       break;
     }
+
+    /* 0x0b77 easily shows up in the payload, so only accept a resync if
+     * another frame follows, unless this is the last one */
+    if (!a52dec->synced) {
+      if (length + 2 <= size) {
+        if (data[length] != 0x0b || data[length + 1] != 0x77) {
+          GST_LOG_OBJECT (a52dec, "No sync word after candidate frame");
+          data++;
+          size--;
+          continue;
+        }
+      } else if (!eos) {
+        GST_LOG_OBJECT (a52dec, "Need more data to confirm sync");
+        break;
+      }
+      GST_DEBUG_OBJECT (a52dec, "Got sync at offset %d", av - size);
+      a52dec->synced = TRUE;
+    }
+
+    GST_LOG_OBJECT (a52dec, "Sync: frame size %d", length);
+    result = GST_FLOW_OK;
+    break;
   }
   gst_adapter_unmap (adapter);
 
@@ -426,6 +543,28 @@ gst_a52dec_channels (int flags, GstAudioChannelPosition * pos)
   return chans;
 }
 
+/* Report how long a batch holds back the first frame collected into it,
+ * which is all but the last of output-frames frames of 1536 samples */
+static void
+gst_a52dec_update_latency (GstA52Dec * a52dec)
+{
+  GstClockTime latency = 0;
+
+  if (!a52dec->passthrough_active && a52dec->sample_rate > 0
+      && a52dec->pending_max > 1)
+    latency = gst_util_uint64_scale_int (GST_SECOND,
+        (a52dec->pending_max - 1) * 256 * 6, a52dec->sample_rate);
+
+  if (latency == a52dec->latency)
+    return;
+
+  GST_DEBUG_OBJECT (a52dec, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+  a52dec->latency = latency;
+  gst_audio_decoder_set_latency (GST_AUDIO_DECODER (a52dec), latency,
+      latency);
+}
+
 static gboolean
 gst_a52dec_reneg (GstA52Dec * a52dec)
 {
@@ -434,6 +573,27 @@ gst_a52dec_reneg (GstA52Dec * a52dec)
   GstAudioChannelPosition from[6], to[6];
   GstAudioInfo info;
 
+  if (a52dec->passthrough_active) {
+    GstCaps *caps;
+
+    channels = gst_a52dec_channels (a52dec->stream_channels, NULL);
+    GST_INFO_OBJECT (a52dec, "reneg passthrough channels:%d rate:%d",
+        channels, a52dec->sample_rate);
+
+    caps = gst_caps_new_simple ("audio/x-ac3",
+        "framed", G_TYPE_BOOLEAN, TRUE,
+        "rate", G_TYPE_INT, a52dec->sample_rate,
+        "channels", G_TYPE_INT, channels, NULL);
+    result = gst_audio_decoder_set_output_caps (GST_AUDIO_DECODER (a52dec),
+        caps);
+    gst_caps_unref (caps);
+
+    /* frames go out as they come in */
+    gst_a52dec_update_latency (a52dec);
+
+    return result;
+  }
+
   channels = gst_a52dec_channels (a52dec->using_channels, from);
 
   if (!channels)
@@ -454,6 +614,17 @@ gst_a52dec_reneg (GstA52Dec * a52dec)
   if (!gst_audio_decoder_set_output_format (GST_AUDIO_DECODER (a52dec), &info))
     goto done;
 
+  /* make sure the pool for the new layout uses the allocator picked by
+   * downstream */
+  if (!gst_audio_decoder_negotiate (GST_AUDIO_DECODER (a52dec)))
+    goto done;
+
+  if (a52dec->pool) {
+    gst_buffer_pool_set_active (a52dec->pool, FALSE);
+    gst_object_unref (a52dec->pool);
+    a52dec->pool = NULL;
+  }
+
   result = TRUE;
 
 done:
@@ -474,24 +645,122 @@ gst_a52dec_update_streaminfo (GstA52Dec * a52dec)
   gst_tag_list_unref (taglist);
 }
 
+/* Output buffers come from a pool sized for output-frames decoded frames
+ * of the current layout */
+static GstBuffer *
+gst_a52dec_alloc_output (GstA52Dec * a52dec, gsize size)
+{
+  GstBuffer *outbuf = NULL;
+
+  if (a52dec->pool && a52dec->pool_size != size) {
+    gst_buffer_pool_set_active (a52dec->pool, FALSE);
+    gst_object_unref (a52dec->pool);
+    a52dec->pool = NULL;
+  }
+
+  if (!a52dec->pool) {
+    GstAllocator *allocator;
+    GstAllocationParams params;
+    GstStructure *config;
+
+    gst_audio_decoder_get_allocator (GST_AUDIO_DECODER (a52dec), &allocator,
+        &params);
+
+    a52dec->pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (a52dec->pool);
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, allocator, &params);
+    if (allocator)
+      gst_object_unref (allocator);
+
+    if (!gst_buffer_pool_set_config (a52dec->pool, config) ||
+        !gst_buffer_pool_set_active (a52dec->pool, TRUE)) {
+      GST_WARNING_OBJECT (a52dec, "failed to set up buffer pool");
+      gst_object_unref (a52dec->pool);
+      a52dec->pool = NULL;
+      return gst_audio_decoder_allocate_output_buffer (GST_AUDIO_DECODER
+          (a52dec), size);
+    }
+    a52dec->pool_size = size;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (a52dec->pool, &outbuf,
+          NULL) != GST_FLOW_OK)
+    return NULL;
+
+  return outbuf;
+}
+
+/* Push out the frames collected so far, if any */
+static GstFlowReturn
+gst_a52dec_push_pending (GstA52Dec * a52dec)
+{
+  GstBuffer *outbuf = a52dec->pending;
+  gint frames = a52dec->pending_frames;
+
+  if (outbuf == NULL)
+    return GST_FLOW_OK;
+
+  a52dec->pending = NULL;
+  a52dec->pending_frames = 0;
+
+  if (frames == 0) {
+    gst_buffer_unref (outbuf);
+    return GST_FLOW_OK;
+  }
+
+  gst_buffer_set_size (outbuf, a52dec->pending_offset);
+
+  return gst_audio_decoder_finish_frame (GST_AUDIO_DECODER (a52dec), outbuf,
+      frames);
+}
+
+/* Whether downstream takes nothing but AC-3, e.g. a sink on a S/PDIF only
+ * device or a capsfilter asking for it, in which case decoding is pointless */
+static gboolean
+gst_a52dec_downstream_wants_ac3 (GstA52Dec * a52dec)
+{
+  GstCaps *caps;
+  gboolean result;
+  guint i;
+
+  caps = gst_pad_get_allowed_caps (GST_AUDIO_DECODER_SRC_PAD (a52dec));
+  if (caps == NULL)
+    return FALSE;
+
+  result = !gst_caps_is_empty (caps);
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    if (!gst_structure_has_name (gst_caps_get_structure (caps, i),
+            "audio/x-ac3"))
+      result = FALSE;
+  }
+  gst_caps_unref (caps);
+
+  GST_DEBUG_OBJECT (a52dec, "downstream only takes AC-3: %d", result);
+
+  return result;
+}
+
 static GstFlowReturn
 gst_a52dec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buffer)
 {
   GstA52Dec *a52dec;
   gint channels, i;
   gboolean need_reneg = FALSE;
+  gboolean passthrough;
   gint chans;
   gint length = 0, flags, sample_rate, bit_rate;
   GstMapInfo map;
   GstFlowReturn result = GST_FLOW_OK;
   GstBuffer *outbuf;
   const gint num_blocks = 6;
+  gsize frame_size;
 
   a52dec = GST_A52DEC (bdec);
 
-  /* no fancy draining */
+  /* no fancy draining, only push what was collected */
   if (G_UNLIKELY (!buffer))
-    return GST_FLOW_OK;
+    return gst_a52dec_push_pending (a52dec);
 
   /* parsed stuff already, so this should work out fine */
   gst_buffer_map (buffer, &map, GST_MAP_READ);
@@ -527,6 +796,44 @@ gst_a52dec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buffer)
     gst_a52dec_update_streaminfo (a52dec);
   }
 
+  GST_OBJECT_LOCK (a52dec);
+  passthrough = a52dec->passthrough;
+  GST_OBJECT_UNLOCK (a52dec);
+
+  /* look at downstream again whenever it asks for renegotiation */
+  if (!a52dec->downstream_checked
+      || gst_pad_needs_reconfigure (GST_AUDIO_DECODER_SRC_PAD (a52dec))) {
+    a52dec->downstream_ac3 = gst_a52dec_downstream_wants_ac3 (a52dec);
+    a52dec->downstream_checked = TRUE;
+  }
+  passthrough = passthrough || a52dec->downstream_ac3;
+
+  if (a52dec->passthrough_active != passthrough) {
+    GST_DEBUG_OBJECT (a52dec, "passthrough changed to %d", passthrough);
+    need_reneg = TRUE;
+    a52dec->passthrough_active = passthrough;
+    a52dec->flag_update = TRUE;
+  }
+
+  if (a52dec->passthrough_active) {
+    if (need_reneg || a52dec->flag_update) {
+      a52dec->flag_update = FALSE;
+      result = gst_a52dec_push_pending (a52dec);
+      if (result != GST_FLOW_OK) {
+        gst_buffer_unmap (buffer, &map);
+        goto exit;
+      }
+      if (!gst_a52dec_reneg (a52dec)) {
+        gst_buffer_unmap (buffer, &map);
+        goto failed_negotiation;
+      }
+    }
+    gst_buffer_unmap (buffer, &map);
+    result = gst_audio_decoder_finish_frame (GST_AUDIO_DECODER (a52dec),
+        gst_buffer_ref (buffer), 1);
+    goto exit;
+  }
+
   /* If we haven't had an explicit number of channels chosen through properties
    * at this point, choose what to downmix to now, based on what the peer will
    * accept - this allows a52dec to do downmixing in preference to a
@@ -602,6 +909,10 @@ gst_a52dec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buffer)
     GST_DEBUG_OBJECT (a52dec,
         "a52dec reneg: sample_rate:%d stream_chans:%d using_chans:%d",
         a52dec->sample_rate, a52dec->stream_channels, a52dec->using_channels);
+    /* the collected frames still have the old layout */
+    result = gst_a52dec_push_pending (a52dec);
+    if (result != GST_FLOW_OK)
+      goto exit;
     if (!gst_a52dec_reneg (a52dec))
       goto failed_negotiation;
   }
@@ -617,12 +928,27 @@ gst_a52dec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buffer)
 
   /* handle decoded data;
    * each frame has 6 blocks, one block is 256 samples, ea */
-  outbuf =
-      gst_buffer_new_and_alloc (256 * chans * (SAMPLE_WIDTH / 8) * num_blocks);
+  frame_size = 256 * chans * (SAMPLE_WIDTH / 8) * num_blocks;
+
+  if (a52dec->pending == NULL) {
+    GST_OBJECT_LOCK (a52dec);
+    a52dec->pending_max = a52dec->output_frames;
+    GST_OBJECT_UNLOCK (a52dec);
+    /* the batch size or the rate may have changed since the last one */
+    gst_a52dec_update_latency (a52dec);
+
+    a52dec->pending =
+        gst_a52dec_alloc_output (a52dec, frame_size * a52dec->pending_max);
+    if (a52dec->pending == NULL)
+      goto no_buffer;
+    a52dec->pending_frames = 0;
+    a52dec->pending_offset = 0;
+  }
+  outbuf = a52dec->pending;
 
   gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
   {
-    guint8 *ptr = map.data;
+    guint8 *ptr = map.data + a52dec->pending_offset;
     for (i = 0; i < num_blocks; i++) {
       if (a52_block (a52dec->state)) {
         /* also marks discont */
@@ -630,31 +956,34 @@ gst_a52dec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buffer)
             ("error decoding block %d", i), result);
         if (result != GST_FLOW_OK) {
           gst_buffer_unmap (outbuf, &map);
-          gst_buffer_unref (outbuf);
+          gst_buffer_replace (&a52dec->pending, NULL);
+          a52dec->pending_frames = 0;
           goto exit;
         }
       } else {
-        gint n, c;
-        gint *reorder_map = a52dec->channel_reorder_map;
-
-        for (n = 0; n < 256; n++) {
-          for (c = 0; c < chans; c++) {
-            ((sample_t *) ptr)[n * chans + reorder_map[c]] =
-                a52dec->samples[c * 256 + n];
-          }
-        }
+        gst_a52dec_interleave ((sample_t *) ptr, a52dec->samples, chans,
+            a52dec->channel_reorder_map);
       }
       ptr += 256 * chans * (SAMPLE_WIDTH / 8);
     }
   }
   gst_buffer_unmap (outbuf, &map);
 
-  result = gst_audio_decoder_finish_frame (bdec, outbuf, 1);
+  a52dec->pending_offset += frame_size;
+  a52dec->pending_frames++;
+  if (a52dec->pending_frames >= a52dec->pending_max)
+    result = gst_a52dec_push_pending (a52dec);
 
 exit:
   return result;
 
   /* ERRORS */
+no_buffer:
+  {
+    GST_ELEMENT_ERROR (a52dec, RESOURCE, FAILED, (NULL),
+        ("failed to allocate output buffer"));
+    return GST_FLOW_ERROR;
+  }
 failed_negotiation:
   {
     GST_ELEMENT_ERROR (a52dec, CORE, NEGOTIATION, (NULL), (NULL));
@@ -715,8 +1044,10 @@ gst_a52dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       if (len <= 0 || offset + len > size)
         goto bad_first_access_parameter;
 
-      subbuf = gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, offset, len);
-      GST_BUFFER_TIMESTAMP (subbuf) = GST_CLOCK_TIME_NONE;
+      /* the tail of the previous frame has no timestamp of its own; share
+       * the memory and only keep the flags (e.g. DISCONT) */
+      subbuf = gst_buffer_copy_region (buf,
+          GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_MEMORY, offset, len);
       ret = a52dec->base_chain (pad, parent, subbuf);
       if (ret != GST_FLOW_OK) {
         gst_buffer_unref (buf);
@@ -727,20 +1058,20 @@ gst_a52dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       len = size - offset;
 
       if (len > 0) {
-        subbuf = gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, offset, len);
-        GST_BUFFER_TIMESTAMP (subbuf) = GST_BUFFER_TIMESTAMP (buf);
+        /* trim the remainder in place, the timestamp applies to it */
+        buf = gst_buffer_make_writable (buf);
+        gst_buffer_resize (buf, offset, len);
+        GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_DISCONT);
 
-        ret = a52dec->base_chain (pad, parent, subbuf);
+        ret = a52dec->base_chain (pad, parent, buf);
+      } else {
+        gst_buffer_unref (buf);
       }
-      gst_buffer_unref (buf);
     } else {
       /* first_access = 0 or 1, so if there's a timestamp it applies to the first byte */
-      subbuf =
-          gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, offset,
-          size - offset);
-      GST_BUFFER_TIMESTAMP (subbuf) = GST_BUFFER_TIMESTAMP (buf);
-      gst_buffer_unref (buf);
-      ret = a52dec->base_chain (pad, parent, subbuf);
+      buf = gst_buffer_make_writable (buf);
+      gst_buffer_resize (buf, offset, size - offset);
+      ret = a52dec->base_chain (pad, parent, buf);
     }
   } else {
     ret = a52dec->base_chain (pad, parent, buf);
@@ -790,6 +1121,16 @@ gst_a52dec_set_property (GObject * object, guint prop_id, const GValue * value,
       src->request_channels |= g_value_get_boolean (value) ? A52_LFE : 0;
       GST_OBJECT_UNLOCK (src);
       break;
+    case ARG_PASSTHROUGH:
+      GST_OBJECT_LOCK (src);
+      src->passthrough = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case ARG_OUTPUT_FRAMES:
+      GST_OBJECT_LOCK (src);
+      src->output_frames = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -818,6 +1159,16 @@ gst_a52dec_get_property (GObject * object, guint prop_id, GValue * value,
       g_value_set_boolean (value, src->request_channels & A52_LFE);
       GST_OBJECT_UNLOCK (src);
       break;
+    case ARG_PASSTHROUGH:
+      GST_OBJECT_LOCK (src);
+      g_value_set_boolean (value, src->passthrough);
+      GST_OBJECT_UNLOCK (src);
+      break;
+    case ARG_OUTPUT_FRAMES:
+      GST_OBJECT_LOCK (src);
+      g_value_set_uint (value, src->output_frames);
+      GST_OBJECT_UNLOCK (src);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
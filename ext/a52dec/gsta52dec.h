@@ -48,6 +48,7 @@ struct _GstA52Dec {
 
   gboolean       dvdmode;
   gboolean       flag_update;
+  gboolean       synced;
   int            prev_flags;
 
   /* stream properties */
@@ -62,6 +63,21 @@ struct _GstA52Dec {
   sample_t       level;
   sample_t       bias;
   gboolean       dynamic_range_compression;
+  gboolean       passthrough;
+  gboolean       passthrough_active;    /* passing on AC-3 frames */
+  gboolean       downstream_ac3;
+  gboolean       downstream_checked;
+  guint          output_frames;
+
+  /* decoded frames collected for the next output buffer */
+  GstBuffer     *pending;
+  gint           pending_frames;
+  gint           pending_max;
+  gsize          pending_offset;
+  GstClockTime   latency;               /* held back by a batch */
+
+  GstBufferPool *pool;
+  gsize          pool_size;
   sample_t      *samples;
   a52_state_t   *state;
 };
@@ -0,0 +1,86 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_A52_INTERLEAVE_H__
+#define __GST_A52_INTERLEAVE_H__
+
+/* Needs sample_t, so include <a52dec/a52.h> before this. Kept in a header of
+ * its own so the unit test can check it against the plain loop. */
+
+#include <glib.h>
+
+#if defined(_MSC_VER) && !defined(restrict)
+#define restrict __restrict
+#endif
+
+/* liba52 hands out each block as 256 samples per channel, one channel after
+ * the other. Interleave them into @dest, putting channel c at position
+ * reorder_map[c]. Stereo and 5.1 get a version with a constant stride the
+ * compiler can unroll and vectorize; @dest and @src never overlap, and each
+ * output pointer only touches its own channel's samples. */
+static inline void
+gst_a52dec_interleave (sample_t * restrict dest,
+    const sample_t * restrict src, gint chans, const gint * restrict reorder_map)
+{
+  gint n, c;
+
+  switch (chans) {
+    case 2:{
+      sample_t *restrict d0 = dest + reorder_map[0];
+      sample_t *restrict d1 = dest + reorder_map[1];
+      const sample_t *restrict s0 = src;
+      const sample_t *restrict s1 = src + 256;
+
+      for (n = 0; n < 256; n++) {
+        d0[2 * n] = s0[n];
+        d1[2 * n] = s1[n];
+      }
+      break;
+    }
+    case 6:{
+      sample_t *restrict d0 = dest + reorder_map[0];
+      sample_t *restrict d1 = dest + reorder_map[1];
+      sample_t *restrict d2 = dest + reorder_map[2];
+      sample_t *restrict d3 = dest + reorder_map[3];
+      sample_t *restrict d4 = dest + reorder_map[4];
+      sample_t *restrict d5 = dest + reorder_map[5];
+
+      for (n = 0; n < 256; n++) {
+        d0[6 * n] = src[n];
+        d1[6 * n] = src[256 + n];
+        d2[6 * n] = src[512 + n];
+        d3[6 * n] = src[768 + n];
+        d4[6 * n] = src[1024 + n];
+        d5[6 * n] = src[1280 + n];
+      }
+      break;
+    }
+    default:
+      /* go channel by channel to read the input sequentially */
+      for (c = 0; c < chans; c++) {
+        sample_t *restrict d = dest + reorder_map[c];
+        const sample_t *restrict s = src + c * 256;
+
+        for (n = 0; n < 256; n++)
+          d[n * chans] = s[n];
+      }
+      break;
+  }
+}
+
+#endif /* __GST_A52_INTERLEAVE_H__ */
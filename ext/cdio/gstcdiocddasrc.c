@@ -42,6 +42,10 @@
  * databases for artist/title information. These disc IDs will also be
  * posted on the bus as part of the tag messages.
  *
+ * The CD-TEXT of recently used discs and the detected sample endianness of
+ * each drive are cached in the user's cache directory, so that opening the
+ * same disc again only needs to read its table of contents.
+ *
  * cdiocddasrc supports the GstUriHandler interface, so applications can use
  * playbin with cdda://&lt;track-number&gt; URIs for playback (they will have
  * to connect to playbin's notify::source signal and set the device on the
@@ -75,16 +79,34 @@
 #include <string.h>
 #include <errno.h>
 
-#define SAMPLES_PER_SECTOR (CDIO_CD_FRAMESIZE_RAW / sizeof (gint16))
+/* number of sectors read from the drive in one go */
+#define SECTORS_PER_READ   16
+
+/* number of discs to remember TOC and CD-TEXT for */
+#define MAX_CACHED_DISCS   64
+
+/* sectors to read ahead at most for detecting the sample endianness, before
+ * handing out the ones read for playback */
+#define DETECT_READ_AHEAD  (4 * SECTORS_PER_READ)
 
 #define DEFAULT_READ_SPEED   -1
+#define DEFAULT_PREFETCH_DEPTH 0
 
 enum
 {
   PROP_0 = 0,
-  PROP_READ_SPEED
+  PROP_READ_SPEED,
+  PROP_PREFETCH_DEPTH,
+  PROP_PREFETCH_UNDERRUNS
 };
 
+typedef struct
+{
+  GstBuffer *buf;               /* NULL if the read failed */
+  gint start;
+  gint len;
+} GstCdioCddaSrcChunk;
+
 GST_DEBUG_CATEGORY (gst_cdio_debug);
 
 
@@ -165,141 +187,551 @@ empty_devices:
 }
 #endif
 
-static GstBuffer *
-gst_cdio_cdda_src_read_sector (GstAudioCdSrc * audiocdsrc, gint sector)
+/* number of sectors from @sector to the end of the audio track containing
+ * it, so that reads never cross into a data track or past the disc end */
+static gint
+gst_cdio_cdda_src_get_sectors_left (GstCdioCddaSrc * src, gint sector)
 {
-  GstCdioCddaSrc *src;
-  guint8 *data;
+  guint i;
 
-  src = GST_CDIO_CDDA_SRC (audiocdsrc);
+  for (i = 0; i < src->num_tracks; ++i) {
+    if (sector >= src->tracks[i].start && sector <= src->tracks[i].end)
+      return src->tracks[i].end - sector + 1;
+  }
 
-  data = g_malloc (CDIO_CD_FRAMESIZE_RAW);
+  return 1;
+}
 
-  /* can't use pad_alloc because we can't return the GstFlowReturn (FIXME 0.11) */
-  if (cdio_read_audio_sector (src->cdio, data, sector) != 0)
-    goto read_failed;
+/* The cache remembers per drive whether samples need swapping, and per
+ * disc the CD-TEXT tags, so that re-opening doesn't have to read them from
+ * the drive again. Discs are identified by their TOC, which is read on
+ * every open anyway */
+static gchar *
+gst_cdio_cdda_src_get_cache_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gstreamer-1.0",
+      "cdiocddasrc.cache", NULL);
+}
+
+static GKeyFile *
+gst_cdio_cdda_src_load_cache (GstCdioCddaSrc * src)
+{
+  GKeyFile *cache;
+  GError *err = NULL;
+  gchar *filename;
 
-  if (src->swap_le_be) {
-    gint16 *pcm_data = (gint16 *) data;
-    gint i;
+  cache = g_key_file_new ();
+  filename = gst_cdio_cdda_src_get_cache_filename ();
 
-    for (i = 0; i < SAMPLES_PER_SECTOR; ++i)
-      pcm_data[i] = GUINT16_SWAP_LE_BE (pcm_data[i]);
+  if (!g_key_file_load_from_file (cache, filename, G_KEY_FILE_NONE, &err)) {
+    GST_DEBUG_OBJECT (src, "no cache loaded from %s: %s", filename,
+        err->message);
+    g_clear_error (&err);
   }
 
-  return gst_buffer_new_wrapped (data, CDIO_CD_FRAMESIZE_RAW);
+  g_free (filename);
+  return cache;
+}
 
-  /* ERRORS */
-read_failed:
-  {
-    GST_WARNING_OBJECT (src, "read at sector %d failed!", sector);
-    GST_ELEMENT_ERROR (src, RESOURCE, READ,
-        (_("Could not read from CD.")),
-        ("cdio_read_audio_sector at %d failed: %s", sector,
-            g_strerror (errno)));
-    g_free (data);
-    return NULL;
+static void
+gst_cdio_cdda_src_save_cache (GstCdioCddaSrc * src, GKeyFile * cache)
+{
+  GError *err = NULL;
+  gchar *filename, *dirname;
+
+  filename = gst_cdio_cdda_src_get_cache_filename ();
+  dirname = g_path_get_dirname (filename);
+
+  if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+      !g_key_file_save_to_file (cache, filename, &err)) {
+    GST_WARNING_OBJECT (src, "could not write cache %s: %s", filename,
+        err ? err->message : g_strerror (errno));
+    g_clear_error (&err);
   }
+
+  g_free (dirname);
+  g_free (filename);
 }
 
-static gboolean
-gst_cdio_cdda_src_do_detect_drive_endianness (GstCdioCddaSrc * src, gint from,
-    gint to)
-{
-  gint16 pcm_data[SAMPLES_PER_SECTOR], last_pcm_ne, last_pcm_oe;
-  gdouble ne_sumd0, ne_sumd1, ne_factor;
-  gdouble oe_sumd0, oe_sumd1, oe_factor;
-  gdouble diff;
-  gint sector;
+static gchar *
+gst_cdio_cdda_src_get_drive_group (GstCdioCddaSrc * src, const gchar * device)
+{
+  cdio_hwinfo_t hwinfo = { {0,}, };
+  gchar *id, *checksum, *group;
+
+  /* the device path alone might refer to another drive after a reboot */
+  if (cdio_get_hwinfo (src->cdio, &hwinfo)) {
+    id = g_strdup_printf ("%s\n%s\n%s\n%s", device, hwinfo.psz_vendor,
+        hwinfo.psz_model, hwinfo.psz_revision);
+  } else {
+    id = g_strdup (device);
+  }
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, id, -1);
+  group = g_strdup_printf ("drive %s", checksum);
+  g_free (checksum);
+  g_free (id);
+
+  return group;
+}
+
+static gchar *
+gst_cdio_cdda_src_get_toc_string (GstCdioCddaSrc * src, gint first_track,
+    gint num_tracks)
+{
+  GString *toc;
   gint i;
 
-  ne_sumd0 = ne_sumd1 = 0.0;
-  oe_sumd0 = oe_sumd1 = 0.0;
-  last_pcm_ne = 0;
-  last_pcm_oe = 0;
+  toc = g_string_new (NULL);
+  g_string_append_printf (toc, "%d", first_track);
+  for (i = 0; i < num_tracks; ++i) {
+    g_string_append_printf (toc, " %d",
+        (gint) cdio_get_track_lsn (src->cdio, i + first_track));
+  }
+  g_string_append_printf (toc, " %d",
+      (gint) cdio_get_track_lsn (src->cdio, CDIO_CDROM_LEADOUT_TRACK));
 
-  GST_LOG_OBJECT (src, "checking sector %d to %d", from, to);
+  return g_string_free (toc, FALSE);
+}
 
-  for (sector = from; sector < to; ++sector) {
-    if (cdio_read_audio_sector (src->cdio, pcm_data, sector) != 0)
-      goto read_failed;
+static void
+gst_cdio_cdda_src_add_cached_disc (GKeyFile * cache, const gchar * group)
+{
+  gchar **groups;
+  gsize i, n_groups, n_discs = 0;
+
+  /* groups are kept in insertion order, so drop the oldest discs */
+  groups = g_key_file_get_groups (cache, &n_groups);
+  for (i = 0; i < n_groups; ++i) {
+    if (g_str_has_prefix (groups[i], "disc "))
+      n_discs++;
+  }
+  for (i = 0; i < n_groups && n_discs >= MAX_CACHED_DISCS; ++i) {
+    if (g_str_has_prefix (groups[i], "disc ")) {
+      g_key_file_remove_group (cache, groups[i], NULL);
+      n_discs--;
+    }
+  }
+  g_strfreev (groups);
 
-    /* only evaluate samples for left channel */
-    for (i = 0; i < SAMPLES_PER_SECTOR; i += 2) {
-      gint16 pcm;
+  g_key_file_remove_group (cache, group, NULL);
+}
 
-      /* Native endianness first */
-      pcm = pcm_data[i];
-      ne_sumd0 += abs (pcm);
-      ne_sumd1 += abs (pcm - last_pcm_ne);
-      last_pcm_ne = pcm;
+static GstTagList *
+gst_cdio_cdda_src_get_cached_tags (GKeyFile * cache, const gchar * group,
+    const gchar * key)
+{
+  GstTagList *tags = NULL;
+  gchar *str;
 
-      /* other endianness next */
-      pcm = GUINT16_SWAP_LE_BE (pcm);
-      oe_sumd0 += abs (pcm);
-      oe_sumd1 += abs (pcm - last_pcm_oe);
-      last_pcm_oe = pcm;
+  str = g_key_file_get_string (cache, group, key, NULL);
+  if (str != NULL) {
+    tags = gst_tag_list_new_from_string (str);
+    g_free (str);
+  }
+
+  return tags;
+}
+
+static void
+gst_cdio_cdda_src_set_cached_tags (GKeyFile * cache, const gchar * group,
+    const gchar * key, const GstTagList * tags)
+{
+  gchar *str;
+
+  if (tags == NULL || gst_tag_list_is_empty (tags))
+    return;
+
+  str = gst_tag_list_to_string (tags);
+  g_key_file_set_string (cache, group, key, str);
+  g_free (str);
+}
+
+/* reads up to @count sectors into @buf as they come from the drive and
+ * resizes it to what was read. Returns the number of sectors read, 0 on
+ * error */
+static gint
+gst_cdio_cdda_src_read_sectors (GstCdioCddaSrc * src, GstBuffer * buf,
+    gint sector, gint count)
+{
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE))
+    return 0;
+
+  GST_LOG_OBJECT (src, "reading %d sectors at sector %d", count, sector);
+
+  if (cdio_read_audio_sectors (src->cdio, map.data, sector, count) != 0) {
+    /* some drives fail multi-sector reads near damaged areas, fall back to
+     * reading just the requested sector */
+    if (count > 1) {
+      GST_DEBUG_OBJECT (src, "reading %d sectors at %d failed, trying one",
+          count, sector);
+      count = 1;
     }
+    if (cdio_read_audio_sector (src->cdio, map.data, sector) != 0)
+      count = 0;
+  }
+
+  gst_buffer_unmap (buf, &map);
+
+  if (count > 0)
+    gst_buffer_resize (buf, 0, count * CDIO_CD_FRAMESIZE_RAW);
+
+  return count;
+}
+
+static gboolean
+gst_cdio_cdda_src_detect_add (GstCdioCddaSrc * src, GstBuffer * buf)
+{
+  GstMapInfo map;
+  gboolean audio;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  audio = gst_cdio_endianness_detect_add (&src->detect, map.data,
+      map.size / CDIO_CD_FRAMESIZE_RAW);
+  gst_buffer_unmap (buf, &map);
+
+  return audio;
+}
+
+/* one memory at a time, so that sectors read ahead aren't merged */
+static void
+gst_cdio_cdda_src_swap_buffer (GstBuffer * buf)
+{
+  GstMapInfo map;
+  guint i;
 
+  for (i = 0; i < gst_buffer_n_memory (buf); i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buf, i);
+
+    gst_memory_map (mem, &map, GST_MAP_READWRITE);
+    gst_cdio_cdda_src_swap_samples (map.data, map.size);
+    gst_memory_unmap (mem, &map);
+  }
+}
+
+/* Reads sectors from the middle of the disc, then from a quarter and three
+ * quarters in, like the detection on open used to. Only used when playback
+ * reached the end of the track without enough audio to decide on */
+static void
+gst_cdio_cdda_src_probe_endianness (GstCdioCddaSrc * src)
+{
+  const gint places[][2] = { {1, 2}, {1, 4}, {3, 4} };
+  gint first, last;
+  guint i;
+  GstBuffer *buf;
+
+  gst_cdio_endianness_detect_init (&src->detect);
+  if (src->num_tracks == 0) {
+    src->detect.result = GST_CDIO_ENDIANNESS_INCONCLUSIVE;
+    return;
   }
 
-  ne_factor = (ne_sumd1 / ne_sumd0);
-  oe_factor = (oe_sumd1 / oe_sumd0);
-  diff = ne_factor - oe_factor;
+  first = src->tracks[0].start;
+  last = src->tracks[src->num_tracks - 1].end;
 
-  GST_DEBUG_OBJECT (src, "Native: %.2f, Other: %.2f, diff: %.2f",
-      ne_factor, oe_factor, diff);
+  for (i = 0; i < G_N_ELEMENTS (places); i++) {
+    gint from, count;
 
-  if (diff > 0.5) {
-    GST_INFO_OBJECT (src, "Drive produces samples in other endianness");
-    src->swap_le_be = TRUE;
-    return TRUE;
-  } else if (diff < -0.5) {
-    GST_INFO_OBJECT (src, "Drive produces samples in host endianness");
-    src->swap_le_be = FALSE;
-    return TRUE;
-  } else {
+    from = first + (last - first) * places[i][0] / places[i][1];
+    count = MIN (last + 1 - from, GST_CDIO_DETECT_SECTORS);
+
+    GST_LOG_OBJECT (src, "probing endianness at sector %d", from);
+
+    buf = gst_buffer_new_allocate (NULL, count * CDIO_CD_FRAMESIZE_RAW, NULL);
+    if (gst_cdio_cdda_src_read_sectors (src, buf, from, count) > 0)
+      gst_cdio_cdda_src_detect_add (src, buf);
+    gst_buffer_unref (buf);
+
+    /* decide on what there is, even if some sectors were silent */
+    if (src->detect.result == GST_CDIO_ENDIANNESS_UNKNOWN)
+      gst_cdio_endianness_detect_decide (&src->detect);
+    if (src->detect.result != GST_CDIO_ENDIANNESS_UNKNOWN)
+      break;
+  }
+}
+
+/* Try to detect if we need to byte-order swap the samples coming from the
+ * drive, which might be the case if the CD drive operates in a different
+ * endianness than the host CPU's endianness (happens on e.g. Powerbook G4).
+ *
+ * This runs on the sectors read for playback, so usually no extra reads are
+ * needed. Digital silence, like at the start of most tracks, reads the same
+ * in both byte orders and is handed out while the detection goes on with the
+ * next sectors. Once @buf holds audio, the following sectors of the track
+ * are read ahead into it until there is a decision, so that no sector is
+ * ever handed out in the wrong byte order. Returns the number of sectors
+ * appended to @buf, which is swapped as needed */
+static gint
+gst_cdio_cdda_src_detect_endianness (GstCdioCddaSrc * src, GstBuffer * buf,
+    gint sector, gint count)
+{
+  GKeyFile *cache;
+  gint left, extra = 0;
+
+  if (!gst_cdio_cdda_src_detect_add (src, buf))
+    return 0;
+
+  left = gst_cdio_cdda_src_get_sectors_left (src, sector) - count;
+  while (src->detect.result == GST_CDIO_ENDIANNESS_UNKNOWN &&
+      extra < DETECT_READ_AHEAD && left > 0) {
+    GstBuffer *next;
+    gint n = MIN (left, SECTORS_PER_READ);
+
+    next = gst_buffer_new_allocate (NULL, n * CDIO_CD_FRAMESIZE_RAW, NULL);
+    n = gst_cdio_cdda_src_read_sectors (src, next, sector + count + extra, n);
+    if (n == 0) {
+      /* reading it for playback will report the error */
+      gst_buffer_unref (next);
+      break;
+    }
+    gst_cdio_cdda_src_detect_add (src, next);
+    gst_buffer_append_memory (buf, gst_buffer_get_memory (next, 0));
+    gst_buffer_unref (next);
+    extra += n;
+    left -= n;
+  }
+
+  if (src->detect.result == GST_CDIO_ENDIANNESS_UNKNOWN)
+    gst_cdio_cdda_src_probe_endianness (src);
+
+  GST_DEBUG_OBJECT (src, "Native: %.2f, Other: %.2f, read ahead %d sectors",
+      src->detect.ne_factor, src->detect.oe_factor, extra);
+
+  src->detect_endianness = FALSE;
+  src->swap_le_be = src->detect.result == GST_CDIO_ENDIANNESS_OTHER;
+
+  if (src->swap_le_be)
+    gst_cdio_cdda_src_swap_buffer (buf);
+
+  /* if that's inconclusive, we give up and assume host endianness, without
+   * caching that */
+  if (src->detect.result == GST_CDIO_ENDIANNESS_INCONCLUSIVE) {
     GST_INFO_OBJECT (src, "Inconclusive, assuming host endianness");
-    src->swap_le_be = FALSE;
-    return FALSE;
+    return extra;
   }
 
-/* ERRORS */
-read_failed:
-  {
-    GST_WARNING_OBJECT (src, "could not read sector %d", sector);
-    src->swap_le_be = FALSE;
-    return FALSE;
+  GST_INFO_OBJECT (src, "Drive produces samples in %s endianness",
+      src->swap_le_be ? "other" : "host");
+
+  cache = gst_cdio_cdda_src_load_cache (src);
+  g_key_file_set_boolean (cache, src->drive_group, "swap-le-be",
+      src->swap_le_be);
+  gst_cdio_cdda_src_save_cache (src, cache);
+  g_key_file_free (cache);
+
+  return extra;
+}
+
+/* reads up to @count sectors into @buf, plus the ones read ahead while
+ * detecting the sample endianness, and swaps them as needed. Returns the
+ * number of sectors in @buf, 0 on error */
+static gint
+gst_cdio_cdda_src_read_chunk (GstCdioCddaSrc * src, GstBuffer * buf,
+    gint sector, gint count)
+{
+  count = gst_cdio_cdda_src_read_sectors (src, buf, sector, count);
+  if (count == 0)
+    return 0;
+
+  if (src->detect_endianness)
+    count += gst_cdio_cdda_src_detect_endianness (src, buf, sector, count);
+  else if (src->swap_le_be)
+    gst_cdio_cdda_src_swap_buffer (buf);
+
+  return count;
+}
+
+static gpointer
+gst_cdio_cdda_src_prefetch_func (GstCdioCddaSrc * src)
+{
+  g_mutex_lock (&src->prefetch_lock);
+  while (!src->prefetch_quit && src->prefetch_next <= src->prefetch_end) {
+    GstCdioCddaSrcChunk *chunk;
+    gint sector, count;
+
+    if (g_queue_get_length (&src->prefetch_queue) >=
+        (guint) MAX (g_atomic_int_get (&src->prefetch_depth), 1)) {
+      g_cond_wait (&src->prefetch_cond, &src->prefetch_lock);
+      continue;
+    }
+
+    sector = src->prefetch_next;
+    count = MIN (src->prefetch_end - sector + 1, SECTORS_PER_READ);
+    g_mutex_unlock (&src->prefetch_lock);
+
+    chunk = g_new0 (GstCdioCddaSrcChunk, 1);
+    chunk->start = sector;
+    chunk->buf = gst_buffer_new_allocate (NULL,
+        count * CDIO_CD_FRAMESIZE_RAW, NULL);
+    chunk->len = gst_cdio_cdda_src_read_chunk (src, chunk->buf, sector, count);
+    if (chunk->len == 0)
+      gst_buffer_replace (&chunk->buf, NULL);
+
+    g_mutex_lock (&src->prefetch_lock);
+    if (src->prefetch_quit) {
+      gst_buffer_replace (&chunk->buf, NULL);
+      g_free (chunk);
+      break;
+    }
+
+    g_queue_push_tail (&src->prefetch_queue, chunk);
+    g_cond_broadcast (&src->prefetch_cond);
+
+    /* let the streaming thread report the error */
+    if (chunk->buf == NULL) {
+      GST_DEBUG_OBJECT (src, "prefetching sector %d failed", sector);
+      break;
+    }
+
+    src->prefetch_next += chunk->len;
+  }
+  src->prefetch_done = TRUE;
+  g_cond_broadcast (&src->prefetch_cond);
+  g_mutex_unlock (&src->prefetch_lock);
+
+  return NULL;
+}
+
+static void
+gst_cdio_cdda_src_stop_prefetch (GstCdioCddaSrc * src)
+{
+  GstCdioCddaSrcChunk *chunk;
+
+  if (src->prefetch_thread == NULL)
+    return;
+
+  g_mutex_lock (&src->prefetch_lock);
+  src->prefetch_quit = TRUE;
+  g_cond_broadcast (&src->prefetch_cond);
+  g_mutex_unlock (&src->prefetch_lock);
+
+  g_thread_join (src->prefetch_thread);
+  src->prefetch_thread = NULL;
+
+  while ((chunk = g_queue_pop_head (&src->prefetch_queue))) {
+    gst_buffer_replace (&chunk->buf, NULL);
+    g_free (chunk);
   }
 }
 
 static void
-gst_cdio_cdda_src_detect_drive_endianness (GstCdioCddaSrc * src, gint first,
-    gint last)
+gst_cdio_cdda_src_start_prefetch (GstCdioCddaSrc * src, gint sector)
 {
-  gint from, to;
+  /* don't read past the end of the track */
+  src->prefetch_next = sector;
+  src->prefetch_end =
+      sector + gst_cdio_cdda_src_get_sectors_left (src, sector) - 1;
+  src->prefetch_expected = sector;
+  src->prefetch_quit = FALSE;
+  src->prefetch_done = FALSE;
+
+  GST_DEBUG_OBJECT (src, "prefetching sectors %d to %d", src->prefetch_next,
+      src->prefetch_end);
+
+  src->prefetch_thread = g_thread_new ("cdiocddasrc-prefetch",
+      (GThreadFunc) gst_cdio_cdda_src_prefetch_func, src);
+}
 
-  GST_INFO ("Detecting drive endianness");
+/* makes the prefetched chunk starting at @sector the current chunk,
+ * restarting the prefetch thread if it was reading elsewhere. Returns
+ * FALSE if no data could be prefetched */
+static gboolean
+gst_cdio_cdda_src_get_prefetched (GstCdioCddaSrc * src, gint sector)
+{
+  GstCdioCddaSrcChunk *chunk;
+  gboolean restart;
 
-  /* try middle of disc first */
-  from = (first + last) / 2;
-  to = MIN (from + 10, last);
-  if (gst_cdio_cdda_src_do_detect_drive_endianness (src, from, to))
-    return;
+  g_mutex_lock (&src->prefetch_lock);
+  restart = src->prefetch_thread == NULL || sector != src->prefetch_expected
+      || (src->prefetch_done && g_queue_is_empty (&src->prefetch_queue));
+  g_mutex_unlock (&src->prefetch_lock);
 
-  /* if that was inconclusive, try other places */
-  from = (first + last) / 4;
-  to = MIN (from + 10, last);
-  if (gst_cdio_cdda_src_do_detect_drive_endianness (src, from, to))
-    return;
+  if (restart) {
+    gst_cdio_cdda_src_stop_prefetch (src);
+    gst_cdio_cdda_src_start_prefetch (src, sector);
+  }
 
-  from = (first + last) * 3 / 4;
-  to = MIN (from + 10, last);
-  if (gst_cdio_cdda_src_do_detect_drive_endianness (src, from, to))
-    return;
+  g_mutex_lock (&src->prefetch_lock);
+  if (g_queue_is_empty (&src->prefetch_queue) && !restart) {
+    GST_DEBUG_OBJECT (src, "prefetch underrun at sector %d", sector);
+    src->prefetch_underruns++;
+  }
+  while (g_queue_is_empty (&src->prefetch_queue) && !src->prefetch_done)
+    g_cond_wait (&src->prefetch_cond, &src->prefetch_lock);
+  chunk = g_queue_pop_head (&src->prefetch_queue);
+  g_cond_broadcast (&src->prefetch_cond);
+  g_mutex_unlock (&src->prefetch_lock);
+
+  if (chunk == NULL)
+    return FALSE;
+
+  if (chunk->buf == NULL) {
+    g_free (chunk);
+    return FALSE;
+  }
+
+  gst_buffer_replace (&src->chunk, NULL);
+  src->chunk = chunk->buf;
+  src->chunk_start = chunk->start;
+  src->chunk_len = chunk->len;
+  src->prefetch_expected = chunk->start + chunk->len;
+  g_free (chunk);
+
+  return TRUE;
+}
 
-  /* if that's still inconclusive, we give up and assume host endianness */
-  return;
+static GstBuffer *
+gst_cdio_cdda_src_read_sector (GstAudioCdSrc * audiocdsrc, gint sector)
+{
+  GstCdioCddaSrc *src;
+  GstBuffer *buf;
+  gint count;
+
+  src = GST_CDIO_CDDA_SRC (audiocdsrc);
+
+  if (src->chunk != NULL && sector >= src->chunk_start &&
+      sector < src->chunk_start + src->chunk_len)
+    goto done;
+
+  if (g_atomic_int_get (&src->prefetch_depth) > 0) {
+    if (gst_cdio_cdda_src_get_prefetched (src, sector))
+      goto done;
+  } else {
+    gst_cdio_cdda_src_stop_prefetch (src);
+  }
+
+  count = gst_cdio_cdda_src_get_sectors_left (src, sector);
+  count = CLAMP (count, 1, SECTORS_PER_READ);
+
+  /* can't use pad_alloc because we can't return the GstFlowReturn (FIXME 0.11) */
+  buf = gst_buffer_new_allocate (NULL, count * CDIO_CD_FRAMESIZE_RAW, NULL);
+  count = gst_cdio_cdda_src_read_chunk (src, buf, sector, count);
+  if (count == 0)
+    goto read_failed;
+
+  gst_buffer_replace (&src->chunk, NULL);
+  src->chunk = buf;
+  src->chunk_start = sector;
+  src->chunk_len = count;
+
+done:
+  return gst_buffer_copy_region (src->chunk, GST_BUFFER_COPY_MEMORY,
+      (sector - src->chunk_start) * CDIO_CD_FRAMESIZE_RAW,
+      CDIO_CD_FRAMESIZE_RAW);
+
+  /* ERRORS */
+read_failed:
+  {
+    GST_WARNING_OBJECT (src, "read at sector %d failed!", sector);
+    GST_ELEMENT_ERROR (src, RESOURCE, READ,
+        (_("Could not read from CD.")),
+        ("cdio_read_audio_sector at %d failed: %s", sector,
+            g_strerror (errno)));
+    gst_buffer_unref (buf);
+    return NULL;
+  }
 }
 
 static gboolean
@@ -314,9 +746,12 @@ gst_cdio_cdda_src_open (GstAudioCdSrc * audiocdsrc, const gchar * device)
   GstCdioCddaSrc *src;
   discmode_t discmode;
   gint first_track, num_tracks, i;
-  gint first_audio_sector = 0, last_audio_sector = 0;
+  GKeyFile *cache;
+  GstTagList *album_tags;
+  gchar *toc, *checksum, *disc_group, *cached_toc;
+  gboolean cached_disc, cache_changed = FALSE;
 #if LIBCDIO_VERSION_NUM > 83 || LIBCDIO_VERSION_NUM < 76
-  cdtext_t *cdtext;
+  cdtext_t *cdtext = NULL;
 #endif
 
   src = GST_CDIO_CDDA_SRC (audiocdsrc);
@@ -344,24 +779,56 @@ gst_cdio_cdda_src_open (GstAudioCdSrc * audiocdsrc, const gchar * device)
   if (src->read_speed != -1)
     cdio_set_speed (src->cdio, src->read_speed);
 
+  cache = gst_cdio_cdda_src_load_cache (src);
+
+  toc = gst_cdio_cdda_src_get_toc_string (src, first_track, num_tracks);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, toc, -1);
+  disc_group = g_strdup_printf ("disc %s", checksum);
+  g_free (checksum);
+  cached_toc = g_key_file_get_string (cache, disc_group, "toc", NULL);
+  cached_disc = (g_strcmp0 (toc, cached_toc) == 0);
+  g_free (cached_toc);
+
+  if (cached_disc) {
+    GST_DEBUG_OBJECT (src, "using cached CD-TEXT");
+    album_tags = gst_cdio_cdda_src_get_cached_tags (cache, disc_group,
+        "album");
+  } else {
+    gst_cdio_cdda_src_add_cached_disc (cache, disc_group);
+    g_key_file_set_string (cache, disc_group, "toc", toc);
+    cache_changed = TRUE;
+
+    album_tags = gst_tag_list_new_empty ();
 #if LIBCDIO_VERSION_NUM > 83 || LIBCDIO_VERSION_NUM < 76
-  cdtext = cdio_get_cdtext (src->cdio);
+    cdtext = cdio_get_cdtext (src->cdio);
 
-  if (NULL == cdtext)
-    GST_DEBUG_OBJECT (src, "no CD-TEXT on disc");
-  else
-    gst_cdio_add_cdtext_album_tags (GST_OBJECT_CAST (src), cdtext,
-        audiocdsrc->tags);
+    if (NULL == cdtext)
+      GST_DEBUG_OBJECT (src, "no CD-TEXT on disc");
+    else
+      gst_cdio_add_cdtext_album_tags (GST_OBJECT_CAST (src), cdtext,
+          album_tags);
 #else
-  gst_cdio_add_cdtext_album_tags (GST_OBJECT_CAST (src), src->cdio,
-      audiocdsrc->tags);
+    gst_cdio_add_cdtext_album_tags (GST_OBJECT_CAST (src), src->cdio,
+        album_tags);
 #endif
+    gst_cdio_cdda_src_set_cached_tags (cache, disc_group, "album",
+        album_tags);
+  }
+
+  if (album_tags != NULL) {
+    gst_tag_list_insert (audiocdsrc->tags, album_tags, GST_TAG_MERGE_REPLACE);
+    gst_tag_list_unref (album_tags);
+  }
 
   GST_LOG_OBJECT (src, "%u tracks, first track: %d", num_tracks, first_track);
 
+  src->tracks = g_new0 (GstCdioCddaSrcTrackRange, num_tracks);
+  src->num_tracks = 0;
+
   for (i = 0; i < num_tracks; ++i) {
     GstAudioCdSrcTrack track = { 0, };
     gint len_sectors;
+    gchar *key;
 
     len_sectors = cdio_get_track_sec_count (src->cdio, i + first_track);
 
@@ -374,26 +841,51 @@ gst_cdio_cdda_src_open (GstAudioCdSrc * audiocdsrc, const gchar * device)
     track.end = track.start + len_sectors - 1;  /* -1? */
 
     if (track.is_audio) {
-      first_audio_sector = MIN (first_audio_sector, track.start);
-      last_audio_sector = MAX (last_audio_sector, track.end);
+      src->tracks[src->num_tracks].start = track.start;
+      src->tracks[src->num_tracks].end = track.end;
+      src->num_tracks++;
     }
+    key = g_strdup_printf ("track-%d", track.num);
+    if (cached_disc) {
+      track.tags = gst_cdio_cdda_src_get_cached_tags (cache, disc_group, key);
+    } else {
 #if LIBCDIO_VERSION_NUM > 83 || LIBCDIO_VERSION_NUM < 76
-    if (NULL != cdtext)
-      track.tags = gst_cdio_get_cdtext (GST_OBJECT (src), cdtext,
-          i + first_track);
+      if (NULL != cdtext)
+        track.tags = gst_cdio_get_cdtext (GST_OBJECT (src), cdtext,
+            i + first_track);
 #else
-    track.tags = gst_cdio_get_cdtext (GST_OBJECT (src), src->cdio,
-        i + first_track);
+      track.tags = gst_cdio_get_cdtext (GST_OBJECT (src), src->cdio,
+          i + first_track);
 #endif
+      gst_cdio_cdda_src_set_cached_tags (cache, disc_group, key, track.tags);
+    }
+    g_free (key);
 
     gst_audio_cd_src_add_track (GST_AUDIO_CD_SRC (src), &track);
   }
 
-  /* Try to detect if we need to byte-order swap the samples coming from the
-   * drive, which might be the case if the CD drive operates in a different
-   * endianness than the host CPU's endianness (happens on e.g. Powerbook G4) */
-  gst_cdio_cdda_src_detect_drive_endianness (src, first_audio_sector,
-      last_audio_sector);
+  /* Only conclusive endianness detection results are cached, otherwise
+   * detect it on the first sectors read */
+  g_free (src->drive_group);
+  src->drive_group = gst_cdio_cdda_src_get_drive_group (src, device);
+  gst_cdio_endianness_detect_init (&src->detect);
+  if (g_key_file_has_key (cache, src->drive_group, "swap-le-be", NULL)) {
+    src->swap_le_be = g_key_file_get_boolean (cache, src->drive_group,
+        "swap-le-be", NULL);
+    src->detect_endianness = FALSE;
+    GST_INFO_OBJECT (src, "using cached drive endianness, swap: %d",
+        src->swap_le_be);
+  } else {
+    src->swap_le_be = FALSE;
+    src->detect_endianness = TRUE;
+  }
+
+  if (cache_changed)
+    gst_cdio_cdda_src_save_cache (src, cache);
+
+  g_free (disc_group);
+  g_free (toc);
+  g_key_file_free (cache);
 
   return TRUE;
 
@@ -421,6 +913,20 @@ gst_cdio_cdda_src_close (GstAudioCdSrc * audiocdsrc)
 {
   GstCdioCddaSrc *src = GST_CDIO_CDDA_SRC (audiocdsrc);
 
+  gst_cdio_cdda_src_stop_prefetch (src);
+
+  gst_buffer_replace (&src->chunk, NULL);
+  src->chunk_start = 0;
+  src->chunk_len = 0;
+
+  g_free (src->tracks);
+  src->tracks = NULL;
+  src->num_tracks = 0;
+
+  g_free (src->drive_group);
+  src->drive_group = NULL;
+  src->detect_endianness = FALSE;
+
   if (src->cdio) {
     cdio_destroy (src->cdio);
     src->cdio = NULL;
@@ -431,7 +937,12 @@ static void
 gst_cdio_cdda_src_init (GstCdioCddaSrc * src)
 {
   src->read_speed = DEFAULT_READ_SPEED; /* don't need atomic access here */
+  src->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
   src->cdio = NULL;
+
+  g_mutex_init (&src->prefetch_lock);
+  g_cond_init (&src->prefetch_cond);
+  g_queue_init (&src->prefetch_queue);
 }
 
 static void
@@ -439,6 +950,14 @@ gst_cdio_cdda_src_finalize (GObject * obj)
 {
   GstCdioCddaSrc *src = GST_CDIO_CDDA_SRC (obj);
 
+  gst_cdio_cdda_src_stop_prefetch (src);
+  g_mutex_clear (&src->prefetch_lock);
+  g_cond_clear (&src->prefetch_cond);
+
+  gst_buffer_replace (&src->chunk, NULL);
+  g_free (src->tracks);
+  g_free (src->drive_group);
+
   if (src->cdio) {
     cdio_destroy (src->cdio);
     src->cdio = NULL;
@@ -471,6 +990,34 @@ gst_cdio_cdda_src_class_init (GstCdioCddaSrcClass * klass)
           "Read from device at the specified speed (-1 = default)", -1, 100,
           DEFAULT_READ_SPEED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCdioCddaSrc:prefetch-depth:
+   *
+   * Number of multi-sector chunks to read ahead of playback in a separate
+   * thread, so that drive seeks and spin-ups don't stall the streaming
+   * thread. Prefetching stops at the end of the current track. 0 reads
+   * sectors when they are needed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_PREFETCH_DEPTH,
+      g_param_spec_int ("prefetch-depth", "Prefetch depth",
+          "Number of chunks to read ahead (0 = disabled)", 0, 64,
+          DEFAULT_PREFETCH_DEPTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCdioCddaSrc:prefetch-underruns:
+   *
+   * Number of times playback had to wait for the prefetch thread.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_PREFETCH_UNDERRUNS, g_param_spec_uint ("prefetch-underruns",
+          "Prefetch underruns", "Number of times playback waited for the "
+          "prefetch thread", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "CD audio source (CDDA)", "Source/File",
       "Read audio from CD using libcdio",
@@ -491,6 +1038,9 @@ gst_cdio_cdda_src_set_property (GObject * object, guint prop_id,
       g_atomic_int_set (&src->read_speed, speed);
       break;
     }
+    case PROP_PREFETCH_DEPTH:
+      g_atomic_int_set (&src->prefetch_depth, g_value_get_int (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -511,6 +1061,14 @@ gst_cdio_cdda_src_get_property (GObject * object, guint prop_id,
       g_value_set_int (value, speed);
       break;
     }
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_int (value, g_atomic_int_get (&src->prefetch_depth));
+      break;
+    case PROP_PREFETCH_UNDERRUNS:
+      g_mutex_lock (&src->prefetch_lock);
+      g_value_set_uint (value, src->prefetch_underruns);
+      g_mutex_unlock (&src->prefetch_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
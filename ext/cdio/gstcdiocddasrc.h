@@ -23,6 +23,8 @@
 #include <gst/audio/gstaudiocdsrc.h>
 #include <cdio/cdio.h>
 
+#include "gstcdiosamples.h"
+
 #define GST_TYPE_CDIO_CDDA_SRC            (gst_cdio_cdda_src_get_type ())
 #define GST_CDIO_CDDA_SRC(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_CDIO_CDDA_SRC, GstCdioCddaSrc))
 #define GST_CDIO_CDDA_SRC_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass),  GST_TYPE_CDIO_CDDA_SRC, GstCdioCddaSrcClass))
@@ -32,6 +34,12 @@
 typedef struct _GstCdioCddaSrc GstCdioCddaSrc;
 typedef struct _GstCdioCddaSrcClass GstCdioCddaSrcClass;
 
+typedef struct
+{
+  gint           start;
+  gint           end;           /* last sector, inclusive */
+} GstCdioCddaSrcTrackRange;
+
 struct _GstCdioCddaSrc
 {
   GstAudioCdSrc  audiocdsrc;
@@ -40,7 +48,31 @@ struct _GstCdioCddaSrc
 
   gboolean       swap_le_be;    /* Drive produces samples in other endianness */
 
+  /* endianness detection on the first sectors read */
+  gboolean       detect_endianness;
+  GstCdioEndiannessDetect detect;
+  gchar         *drive_group;   /* cache group of the drive */
+
   CdIo          *cdio;          /* NULL if not open */
+
+  GstCdioCddaSrcTrackRange *tracks;     /* audio tracks */
+  guint          num_tracks;
+
+  GstBuffer     *chunk;         /* last multi-sector read */
+  gint           chunk_start;
+  gint           chunk_len;     /* in sectors */
+
+  gint           prefetch_depth;        /* ATOMIC */
+  GThread       *prefetch_thread;
+  GMutex         prefetch_lock;
+  GCond          prefetch_cond;
+  GQueue         prefetch_queue;        /* of prefetched chunks */
+  gint           prefetch_next;         /* next sector to prefetch */
+  gint           prefetch_end;          /* last sector of the track */
+  gint           prefetch_expected;     /* start of the next chunk to use */
+  gboolean       prefetch_quit;
+  gboolean       prefetch_done;
+  guint          prefetch_underruns;
 };
 
 struct _GstCdioCddaSrcClass
@@ -0,0 +1,177 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_CDIO_SAMPLES_H__
+#define __GST_CDIO_SAMPLES_H__
+
+/* Helpers working on the 16-bit samples read from the drive. Kept in a
+ * header of their own, without libcdio, so the unit test can check them. */
+
+#include <glib.h>
+#include <string.h>
+
+/* Byte swap the samples in @data, which is 4-byte aligned */
+static inline void
+gst_cdio_cdda_src_swap_samples (guint8 * data, gsize size)
+{
+  guint32 *words = (guint32 *) data;
+  gsize i, n_words = size / sizeof (guint32);
+
+  /* swap two samples at a time, this is simple enough for the compiler
+   * to vectorise */
+  for (i = 0; i < n_words; ++i) {
+    guint32 w = words[i];
+
+    words[i] = ((w & 0x00ff00ff) << 8) | ((w >> 8) & 0x00ff00ff);
+  }
+
+  /* and a sample left over */
+  if (size & 2) {
+    guint16 *last = (guint16 *) (data + n_words * sizeof (guint32));
+
+    *last = GUINT16_SWAP_LE_BE (*last);
+  }
+}
+
+/* 16-bit samples in a raw audio sector, CDIO_CD_FRAMESIZE_RAW / 2 */
+#define GST_CDIO_SAMPLES_PER_SECTOR 1176
+
+/* sectors holding more than digital silence to decide the sample byte
+ * order on, and how often to try before giving up */
+#define GST_CDIO_DETECT_SECTORS  10
+#define GST_CDIO_DETECT_ATTEMPTS 3
+
+typedef enum
+{
+  GST_CDIO_ENDIANNESS_UNKNOWN,          /* still collecting sectors */
+  GST_CDIO_ENDIANNESS_NATIVE,
+  GST_CDIO_ENDIANNESS_OTHER,
+  GST_CDIO_ENDIANNESS_INCONCLUSIVE      /* gave up */
+} GstCdioEndianness;
+
+/* Sums of the absolute left channel samples and of the differences between
+ * consecutive ones, for both byte orders, over the sectors of the current
+ * attempt. Audio has much smaller differences than noise, which is what the
+ * wrong byte order looks like. */
+typedef struct
+{
+  guint64 ne_sumd0, ne_sumd1;
+  guint64 oe_sumd0, oe_sumd1;
+  gint16 last_ne, last_oe;
+  gint sectors;
+  gint attempts;
+  gdouble ne_factor, oe_factor;         /* of the last attempt */
+  GstCdioEndianness result;
+} GstCdioEndiannessDetect;
+
+static inline void
+gst_cdio_endianness_detect_init (GstCdioEndiannessDetect * detect)
+{
+  memset (detect, 0, sizeof (GstCdioEndiannessDetect));
+  detect->result = GST_CDIO_ENDIANNESS_UNKNOWN;
+}
+
+/* Decide on the sectors collected so far and start a new attempt if that
+ * was inconclusive */
+static inline void
+gst_cdio_endianness_detect_decide (GstCdioEndiannessDetect * detect)
+{
+  gdouble diff;
+
+  detect->ne_factor = (gdouble) detect->ne_sumd1 / detect->ne_sumd0;
+  detect->oe_factor = (gdouble) detect->oe_sumd1 / detect->oe_sumd0;
+  diff = detect->ne_factor - detect->oe_factor;
+
+  if (diff > 0.5)
+    detect->result = GST_CDIO_ENDIANNESS_OTHER;
+  else if (diff < -0.5)
+    detect->result = GST_CDIO_ENDIANNESS_NATIVE;
+  else if (++detect->attempts >= GST_CDIO_DETECT_ATTEMPTS)
+    detect->result = GST_CDIO_ENDIANNESS_INCONCLUSIVE;
+
+  detect->ne_sumd0 = detect->ne_sumd1 = 0;
+  detect->oe_sumd0 = detect->oe_sumd1 = 0;
+  detect->last_ne = detect->last_oe = 0;
+  detect->sectors = 0;
+}
+
+/* Add @n_sectors sectors of samples as read from the drive, deciding every
+ * GST_CDIO_DETECT_SECTORS sectors until there is a result. Sectors of
+ * digital silence read the same in both byte orders and are skipped; the
+ * others add up exactly like consecutive sectors did in the original
+ * detection. Returns TRUE if any sector was not silent. */
+static inline gboolean
+gst_cdio_endianness_detect_add (GstCdioEndiannessDetect * detect,
+    const guint8 * data, gint n_sectors)
+{
+  const gint16 *pcm = (const gint16 *) data;
+  gboolean audio = FALSE;
+  gint sector, i;
+
+  for (sector = 0; sector < n_sectors;
+      ++sector, pcm += GST_CDIO_SAMPLES_PER_SECTOR) {
+    const guint32 *words = (const guint32 *) pcm;
+    guint32 ne_sumd0, ne_sumd1, oe_sumd0, oe_sumd1, any = 0;
+    gint ne, oe;
+
+    for (i = 0; i < GST_CDIO_SAMPLES_PER_SECTOR / 2; ++i)
+      any |= words[i];
+    if (any == 0)
+      continue;
+    audio = TRUE;
+
+    if (detect->result != GST_CDIO_ENDIANNESS_UNKNOWN)
+      continue;
+
+    /* the first sample continues from the previous sector */
+    ne = pcm[0];
+    oe = (gint16) GUINT16_SWAP_LE_BE ((guint16) ne);
+    ne_sumd0 = ABS (ne);
+    ne_sumd1 = ABS (ne - detect->last_ne);
+    oe_sumd0 = ABS (oe);
+    oe_sumd1 = ABS (oe - detect->last_oe);
+
+    /* no dependencies between iterations besides the sums, so this can be
+     * vectorised. A sector's sums fit into 32 bits */
+    for (i = 2; i < GST_CDIO_SAMPLES_PER_SECTOR; i += 2) {
+      gint ne_prev = pcm[i - 2];
+      gint oe_prev = (gint16) GUINT16_SWAP_LE_BE ((guint16) ne_prev);
+
+      ne = pcm[i];
+      oe = (gint16) GUINT16_SWAP_LE_BE ((guint16) ne);
+      ne_sumd0 += ABS (ne);
+      ne_sumd1 += ABS (ne - ne_prev);
+      oe_sumd0 += ABS (oe);
+      oe_sumd1 += ABS (oe - oe_prev);
+    }
+
+    detect->ne_sumd0 += ne_sumd0;
+    detect->ne_sumd1 += ne_sumd1;
+    detect->oe_sumd0 += oe_sumd0;
+    detect->oe_sumd1 += oe_sumd1;
+    detect->last_ne = pcm[GST_CDIO_SAMPLES_PER_SECTOR - 2];
+    detect->last_oe = (gint16) GUINT16_SWAP_LE_BE ((guint16) detect->last_ne);
+
+    if (++detect->sectors == GST_CDIO_DETECT_SECTORS)
+      gst_cdio_endianness_detect_decide (detect);
+  }
+
+  return audio;
+}
+
+#endif /* __GST_CDIO_SAMPLES_H__ */
@@ -0,0 +1,156 @@
+/* GStreamer DVD title source
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Lookups on the time map of a title. They only work on plain arrays, so
+ * they don't need libdvdread and can be unit tested on their own. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "dvdreadindex.h"
+
+static gint
+gst_dvd_read_index_compare (gconstpointer a, gconstpointer b,
+    gpointer user_data)
+{
+  const GstDvdReadIndexEntry *ea = a, *eb = b;
+
+  if (ea->sector < eb->sector)
+    return -1;
+  if (ea->sector > eb->sector)
+    return 1;
+  return 0;
+}
+
+/* Build a time ordered and a sector ordered copy of the (sector, time)
+ * entries of a VTS time map with @tmu seconds between entries. Returns
+ * whether the map already was in sector order. Free both with g_free(). */
+gboolean
+gst_dvd_read_index_build (const guint32 * map_ent, guint n_entries, guint tmu,
+    GstDvdReadIndexEntry ** by_time, GstDvdReadIndexEntry ** by_sector)
+{
+  gboolean sorted = TRUE;
+  guint j;
+
+  *by_time = g_new (GstDvdReadIndexEntry, n_entries);
+  *by_sector = g_new (GstDvdReadIndexEntry, n_entries);
+
+  /* times are in map order */
+  for (j = 0; j < n_entries; j++) {
+    GstDvdReadIndexEntry *entry = &(*by_time)[j];
+
+    entry->sector = map_ent[j] & 0x7fffffff;
+    entry->discont = (map_ent[j] >> 31) != 0;
+    entry->time = (guint64) tmu * (j + 1) * GST_SECOND;
+
+    if (j > 0 && entry->sector < (*by_time)[j - 1].sector)
+      sorted = FALSE;
+  }
+
+  /* which normally is the sector order too */
+  memcpy (*by_sector, *by_time, n_entries * sizeof (GstDvdReadIndexEntry));
+  if (!sorted)
+    g_qsort_with_data (*by_sector, n_entries, sizeof (GstDvdReadIndexEntry),
+        gst_dvd_read_index_compare, NULL);
+
+  return sorted;
+}
+
+/* find time for sector from the sector ordered index, interpolating between
+ * the entries around it. Returns NONE outside of the index or across
+ * discontinuities */
+GstClockTime
+gst_dvd_read_index_get_time_for_sector (const GstDvdReadIndexEntry *
+    by_sector, guint len, guint sector)
+{
+  const GstDvdReadIndexEntry *prev, *next;
+  guint lo, hi;
+
+  if (sector == 0)
+    return (GstClockTime) 0;
+
+  if (len == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  /* first entry at or after the sector */
+  lo = 0;
+  hi = len;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (by_sector[mid].sector < sector)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == len || lo == 0) {
+    if (lo == 0 && by_sector[0].sector == sector)
+      return by_sector[0].time;
+    return GST_CLOCK_TIME_NONE;
+  }
+
+  next = &by_sector[lo];
+  if (next->sector == sector)
+    return next->time;
+
+  prev = &by_sector[lo - 1];
+  if (next->discont || next->time <= prev->time)
+    return GST_CLOCK_TIME_NONE;
+
+  return prev->time + gst_util_uint64_scale (next->time - prev->time,
+      sector - prev->sector, next->sector - prev->sector);
+}
+
+/* returns the sector of the time ordered index entry at (or before) the
+ * given time, or -1 */
+gint
+gst_dvd_read_index_get_sector_from_time (const GstDvdReadIndexEntry *
+    by_time, guint len, GstClockTime ts)
+{
+  guint lo, hi;
+
+  if (len == 0)
+    return -1;
+
+  /* first entry at or after the time */
+  lo = 0;
+  hi = len;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (by_time[mid].time < ts)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == len) {
+    if (ts == 0)
+      return 0;
+    return -1;
+  }
+
+  if (by_time[lo].time == ts || lo == 0)
+    return by_time[lo].sector;
+
+  return by_time[lo - 1].sector;
+}
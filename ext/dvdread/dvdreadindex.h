@@ -0,0 +1,52 @@
+/* GStreamer DVD title source
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DVD_READ_INDEX_H__
+#define __GST_DVD_READ_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* time map entry of the current title */
+typedef struct {
+  guint32          sector;
+  gboolean         discont;
+  GstClockTime     time;
+} GstDvdReadIndexEntry;
+
+G_GNUC_INTERNAL
+gboolean     gst_dvd_read_index_build (const guint32 * map_ent,
+                                       guint n_entries,
+                                       guint tmu,
+                                       GstDvdReadIndexEntry ** by_time,
+                                       GstDvdReadIndexEntry ** by_sector);
+
+G_GNUC_INTERNAL
+GstClockTime gst_dvd_read_index_get_time_for_sector (const GstDvdReadIndexEntry * by_sector,
+                                                     guint len,
+                                                     guint sector);
+
+G_GNUC_INTERNAL
+gint         gst_dvd_read_index_get_sector_from_time (const GstDvdReadIndexEntry * by_time,
+                                                      guint len,
+                                                      GstClockTime ts);
+
+G_END_DECLS
+
+#endif /* __GST_DVD_READ_INDEX_H__ */
@@ -47,9 +47,17 @@ enum
   ARG_DEVICE,
   ARG_TITLE,
   ARG_CHAPTER,
-  ARG_ANGLE
+  ARG_ANGLE,
+  ARG_READ_AHEAD_VOBUS,
+  ARG_READ_AHEAD_LEVEL,
+  ARG_READ_AHEAD_STALLS
 };
 
+#define DEFAULT_READ_AHEAD_VOBUS 0
+
+/* sectors to read for the first VOBU, before we know their typical size */
+#define DEFAULT_VOBU_ESTIMATE 256
+
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -62,6 +70,9 @@ static GstFormat chapter_format;
 
 static gboolean gst_dvd_read_src_start (GstBaseSrc * basesrc);
 static gboolean gst_dvd_read_src_stop (GstBaseSrc * basesrc);
+static gboolean gst_dvd_read_src_unlock (GstBaseSrc * basesrc);
+static gboolean gst_dvd_read_src_unlock_stop (GstBaseSrc * basesrc);
+static void gst_dvd_read_src_stop_read_ahead (GstDvdReadSrc * src);
 static GstFlowReturn gst_dvd_read_src_create (GstPushSrc * pushsrc,
     GstBuffer ** buf);
 static gboolean gst_dvd_read_src_src_query (GstBaseSrc * basesrc,
@@ -84,6 +95,7 @@ static gboolean gst_dvd_read_src_do_seek (GstBaseSrc * src, GstSegment * s);
 static gint64 gst_dvd_read_src_convert_timecode (dvd_time_t * time);
 static gint gst_dvd_read_src_get_next_cell (GstDvdReadSrc * src,
     pgc_t * pgc, gint cell);
+static void gst_dvd_read_src_build_index (GstDvdReadSrc * src);
 static GstClockTime gst_dvd_read_src_get_time_for_sector (GstDvdReadSrc * src,
     guint sector);
 static gint gst_dvd_read_src_get_sector_from_time (GstDvdReadSrc * src,
@@ -105,6 +117,8 @@ gst_dvd_read_src_finalize (GObject * object)
   GstDvdReadSrc *src = GST_DVD_READ_SRC (object);
 
   g_free (src->location);
+  g_mutex_clear (&src->read_ahead_lock);
+  g_cond_clear (&src->read_ahead_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -129,6 +143,11 @@ gst_dvd_read_src_init (GstDvdReadSrc * src)
   src->title_lang_event_pending = NULL;
   src->pending_clut_event = NULL;
 
+  src->read_ahead_vobus = DEFAULT_READ_AHEAD_VOBUS;
+  g_mutex_init (&src->read_ahead_lock);
+  g_cond_init (&src->read_ahead_cond);
+  g_queue_init (&src->read_ahead_queue);
+
   gst_pad_use_fixed_caps (GST_BASE_SRC_PAD (src));
   gst_pad_set_caps (GST_BASE_SRC_PAD (src),
       gst_static_pad_template_get_caps (&srctemplate));
@@ -166,6 +185,47 @@ gst_dvd_read_src_class_init (GstDvdReadSrcClass * klass)
       g_param_spec_int ("angle", "angle", "angle",
           1, 999, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstDvdReadSrc:read-ahead-vobus:
+   *
+   * Number of VOBUs to read ahead of playback in a separate thread, so
+   * that the latency of the drive is not paid for each VOBU. 0 reads each
+   * VOBU when it is needed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      ARG_READ_AHEAD_VOBUS, g_param_spec_int ("read-ahead-vobus",
+          "Read-ahead VOBUs", "Number of VOBUs to read ahead (0 = disabled)",
+          0, 64, DEFAULT_READ_AHEAD_VOBUS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDvdReadSrc:read-ahead-level:
+   *
+   * Number of VOBUs currently read ahead and waiting to be pushed.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      ARG_READ_AHEAD_LEVEL, g_param_spec_int ("read-ahead-level",
+          "Read-ahead level", "Number of VOBUs currently read ahead",
+          0, 64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDvdReadSrc:read-ahead-stalls:
+   *
+   * Number of times a VOBU had to be waited for because the read-ahead
+   * thread had none ready.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      ARG_READ_AHEAD_STALLS, g_param_spec_uint ("read-ahead-stalls",
+          "Read-ahead stalls", "Number of times playback waited for the "
+          "read-ahead thread", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
 
   gst_element_class_set_static_metadata (gstelement_class, "DVD Source",
@@ -175,6 +235,9 @@ gst_dvd_read_src_class_init (GstDvdReadSrcClass * klass)
 
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_dvd_read_src_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_dvd_read_src_stop);
+  gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_dvd_read_src_unlock);
+  gstbasesrc_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_dvd_read_src_unlock_stop);
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_dvd_read_src_src_query);
   gstbasesrc_class->event = GST_DEBUG_FUNCPTR (gst_dvd_read_src_src_event);
   gstbasesrc_class->do_seek = GST_DEBUG_FUNCPTR (gst_dvd_read_src_do_seek);
@@ -224,6 +287,9 @@ gst_dvd_read_src_start (GstBaseSrc * basesrc)
 
   src->first_seek = TRUE;
 
+  src->vobu_estimate = DEFAULT_VOBU_ESTIMATE;
+  src->read_ahead_stalls = 0;
+
   return TRUE;
 
   /* ERRORS */
@@ -261,6 +327,8 @@ gst_dvd_read_src_stop (GstBaseSrc * basesrc)
 {
   GstDvdReadSrc *src = GST_DVD_READ_SRC (basesrc);
 
+  gst_dvd_read_src_stop_read_ahead (src);
+
   if (src->vts_file) {
     ifoClose (src->vts_file);
     src->vts_file = NULL;
@@ -284,6 +352,11 @@ gst_dvd_read_src_stop (GstBaseSrc * basesrc)
   src->title = 0;
   src->need_newsegment = TRUE;
   src->vts_tmapt = NULL;
+  g_free (src->index_by_time);
+  g_free (src->index_by_sector);
+  src->index_by_time = NULL;
+  src->index_by_sector = NULL;
+  src->index_len = 0;
   if (src->title_lang_event_pending) {
     gst_event_unref (src->title_lang_event_pending);
     src->title_lang_event_pending = NULL;
@@ -611,6 +684,8 @@ gst_dvd_read_src_goto_title (GstDvdReadSrc * src, gint title, gint angle)
     GST_WARNING_OBJECT (src, "no vts_tmapt - seeking will suck");
   }
 
+  gst_dvd_read_src_build_index (src);
+
   gst_dvd_read_src_get_chapter_starts (src);
 
   return TRUE;
@@ -693,56 +768,48 @@ gst_dvd_read_src_is_nav_pack (const guint8 * data, gint lbn, dsi_t * dsi_pack)
   return TRUE;
 }
 
-/* find time for sector from index, returns NONE if there is no exact match */
-static GstClockTime
-gst_dvd_read_src_get_time_for_sector (GstDvdReadSrc * src, guint sector)
+/* Build the time map index of the current title, so that lookups don't
+ * have to walk the whole map */
+static void
+gst_dvd_read_src_build_index (GstDvdReadSrc * src)
 {
-  gint i, j;
+  vts_tmap_t *tmap;
 
-  if (src->vts_tmapt == NULL || src->vts_tmapt->nr_of_tmaps == 0)
-    return GST_CLOCK_TIME_NONE;
+  g_free (src->index_by_time);
+  g_free (src->index_by_sector);
+  src->index_by_time = NULL;
+  src->index_by_sector = NULL;
+  src->index_len = 0;
 
-  for (i = 0; i < src->vts_tmapt->nr_of_tmaps; ++i) {
-    for (j = 0; j < src->vts_tmapt->tmap[i].nr_of_entries; ++j) {
-      if ((src->vts_tmapt->tmap[i].map_ent[j] & 0x7fffffff) == sector)
-        return (guint64) src->vts_tmapt->tmap[i].tmu * (j + 1) * GST_SECOND;
-    }
+  if (src->vts_tmapt == NULL || src->vts_tmapt->nr_of_tmaps < src->ttn)
+    return;
+
+  tmap = &src->vts_tmapt->tmap[src->ttn - 1];
+  if (tmap->nr_of_entries == 0)
+    return;
+
+  if (!gst_dvd_read_index_build (tmap->map_ent, tmap->nr_of_entries,
+          tmap->tmu, &src->index_by_time, &src->index_by_sector)) {
+    GST_WARNING_OBJECT (src, "time map of title %d is not in sector order",
+        src->title + 1);
   }
+  src->index_len = tmap->nr_of_entries;
 
-  if (sector == 0)
-    return (GstClockTime) 0;
+  GST_DEBUG_OBJECT (src, "index of %u entries", src->index_len);
+}
 
-  return GST_CLOCK_TIME_NONE;
+static GstClockTime
+gst_dvd_read_src_get_time_for_sector (GstDvdReadSrc * src, guint sector)
+{
+  return gst_dvd_read_index_get_time_for_sector (src->index_by_sector,
+      src->index_len, sector);
 }
 
-/* returns the sector in the index at (or before) the given time, or -1 */
 static gint
 gst_dvd_read_src_get_sector_from_time (GstDvdReadSrc * src, GstClockTime ts)
 {
-  gint sector, j;
-
-  if (src->vts_tmapt == NULL || src->vts_tmapt->nr_of_tmaps < src->ttn)
-    return -1;
-
-  sector = src->vts_tmapt->tmap[src->ttn - 1].map_ent[0] & 0x7fffffff;
-
-  for (j = 0; j < src->vts_tmapt->tmap[src->ttn - 1].nr_of_entries; ++j) {
-    GstClockTime entry_time;
-
-    entry_time =
-        (guint64) src->vts_tmapt->tmap[src->ttn - 1].tmu * (j + 1) * GST_SECOND;
-    if (entry_time <= ts) {
-      sector = src->vts_tmapt->tmap[src->ttn - 1].map_ent[j] & 0x7fffffff;
-    }
-    if (entry_time >= ts) {
-      return sector;
-    }
-  }
-
-  if (ts == 0)
-    return 0;
-
-  return -1;
+  return gst_dvd_read_index_get_sector_from_time (src->index_by_time,
+      src->index_len, ts);
 }
 
 typedef enum
@@ -758,11 +825,11 @@ gst_dvd_read_src_read (GstDvdReadSrc * src, gint angle, gint new_seek,
     GstBuffer ** p_buf)
 {
   GstBuffer *buf;
+  GstMemory *mem;
   GstSegment *seg;
-  guint8 oneblock[DVD_VIDEO_LB_LEN];
   dsi_t dsi_pack;
   guint next_vobu, cur_output_size;
-  gint len;
+  gint len, chunk, skip;
   gint retries;
   gint64 next_time;
   GstMapInfo map;
@@ -825,18 +892,40 @@ again:
     return GST_DVD_READ_AGAIN;
   }
 
-  /* read NAV packet */
+  /* read the NAV packet together with as much of the VOBU as we expect,
+   * so that most VOBUs only take a single read */
   retries = 0;
 nav_retry:
-  retries++;
+  chunk = src->cur_pgc->cell_playback[src->cur_cell].last_sector + 1 -
+      src->cur_pack;
+  chunk = CLAMP (chunk, 1, src->vobu_estimate);
 
-  len = DVDReadBlocks (src->dvd_title, src->cur_pack, 1, oneblock);
-  if (len != 1)
+  buf = gst_buffer_new_allocate (NULL, chunk * DVD_VIDEO_LB_LEN, NULL);
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  len = DVDReadBlocks (src->dvd_title, src->cur_pack, chunk, map.data);
+  if (len <= 0) {
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
     goto read_error;
+  }
 
-  if (!gst_dvd_read_src_is_nav_pack (oneblock, src->cur_pack, &dsi_pack)) {
-    GST_LOG_OBJECT (src, "Skipping nav packet @ pack %d", src->cur_pack);
-    src->cur_pack++;
+  for (skip = 0; skip < len; skip++) {
+    if (gst_dvd_read_src_is_nav_pack (map.data + skip * DVD_VIDEO_LB_LEN,
+            src->cur_pack + skip, &dsi_pack))
+      break;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  if (skip > 0) {
+    GST_LOG_OBJECT (src, "Skipping %d non-nav packets @ pack %d", skip,
+        src->cur_pack);
+    src->cur_pack += skip;
+    retries += skip;
+  }
+
+  if (skip == len) {
+    gst_buffer_unref (buf);
 
     if (retries < 2000) {
       goto nav_retry;
@@ -847,6 +936,8 @@ nav_retry:
     }
   }
 
+  len -= skip;
+
   /* determine where we go next. These values are the ones we
    * mostly care about */
   cur_output_size = dsi_pack.dsi_gi.vobu_ea + 1;
@@ -867,23 +958,34 @@ nav_retry:
 
   g_assert (cur_output_size < 1024);
 
-  /* create the buffer (TODO: use buffer pool?) */
-  buf =
-      gst_buffer_new_allocate (NULL, cur_output_size * DVD_VIDEO_LB_LEN, NULL);
-
-  GST_LOG_OBJECT (src, "Going to read %u sectors @ pack %d", cur_output_size,
-      src->cur_pack);
+  GST_LOG_OBJECT (src, "VOBU of %u sectors @ pack %d, have %d",
+      cur_output_size, src->cur_pack, len);
+
+  if (len < cur_output_size) {
+    /* read the rest of the VOBU into a second memory */
+    mem = gst_allocator_alloc (NULL,
+        (cur_output_size - len) * DVD_VIDEO_LB_LEN, NULL);
+    gst_memory_map (mem, &map, GST_MAP_WRITE);
+    chunk = DVDReadBlocks (src->dvd_title, src->cur_pack + len,
+        cur_output_size - len, map.data);
+    gst_memory_unmap (mem, &map);
+
+    if (chunk != cur_output_size - len) {
+      gst_memory_unref (mem);
+      gst_buffer_unref (buf);
+      goto block_read_error;
+    }
 
-  gst_buffer_map (buf, &map, GST_MAP_WRITE);
-  /* read in and output cursize packs */
-  len =
-      DVDReadBlocks (src->dvd_title, src->cur_pack, cur_output_size, map.data);
+    gst_buffer_resize (buf, skip * DVD_VIDEO_LB_LEN, len * DVD_VIDEO_LB_LEN);
+    gst_buffer_append_memory (buf, mem);
+  } else {
+    gst_buffer_resize (buf, skip * DVD_VIDEO_LB_LEN,
+        cur_output_size * DVD_VIDEO_LB_LEN);
+  }
 
-  if (len != cur_output_size)
-    goto block_read_error;
+  /* VOBUs within a cell tend to be of similar size, leave some room */
+  src->vobu_estimate = MIN (cur_output_size + cur_output_size / 4, 1024);
 
-  gst_buffer_unmap (buf, &map);
-  gst_buffer_resize (buf, 0, cur_output_size * DVD_VIDEO_LB_LEN);
   /* GST_BUFFER_OFFSET (buf) = priv->cur_pack * DVD_VIDEO_LB_LEN; */
   GST_BUFFER_TIMESTAMP (buf) =
       gst_dvd_read_src_get_time_for_sector (src, src->cur_pack);
@@ -918,9 +1020,7 @@ read_error:
 block_read_error:
   {
     GST_ERROR_OBJECT (src, "Read failed for %d blocks at %d",
-        cur_output_size, src->cur_pack);
-    gst_buffer_unmap (buf, &map);
-    gst_buffer_unref (buf);
+        cur_output_size - len, src->cur_pack + len);
     return GST_DVD_READ_ERROR;
   }
 }
@@ -944,10 +1044,176 @@ gst_dvd_read_descrambler_available (void)
   return res;
 }
 
+/* An entry of the read-ahead queue */
+typedef struct
+{
+  GstDvdReadReturn res;
+  GstBuffer *buf;
+  /* CLUT of a chapter entered while reading this VOBU */
+  GstEvent *clut_event;
+  /* where reading continues after this VOBU */
+  GstDvdReadPosition pos;
+} GstDvdReadAhead;
+
+static void
+gst_dvd_read_src_save_position (GstDvdReadSrc * src, GstDvdReadPosition * pos)
+{
+  pos->pack = src->cur_pack;
+  pos->cell = src->cur_cell;
+  pos->next_cell = src->next_cell;
+  pos->new_cell = src->new_cell;
+  pos->chapter = src->chapter;
+}
+
+static void
+gst_dvd_read_ahead_free (GstDvdReadAhead * entry)
+{
+  if (entry->buf)
+    gst_buffer_unref (entry->buf);
+  if (entry->clut_event)
+    gst_event_unref (entry->clut_event);
+  g_free (entry);
+}
+
+/* Follows the VOBU chain and cell transitions ahead of playback. The
+ * read state belongs to this thread while it runs; it is stopped before
+ * anything else touches it (seeks, title changes, shutdown). */
+static gpointer
+gst_dvd_read_src_read_ahead_func (GstDvdReadSrc * src)
+{
+  g_mutex_lock (&src->read_ahead_lock);
+  while (!src->read_ahead_quit) {
+    GstDvdReadAhead *entry;
+    GstDvdReadReturn res;
+    GstBuffer *buf = NULL;
+    gint angle;
+
+    if (src->read_ahead_done ||
+        src->read_ahead_queue.length >= src->read_ahead_vobus) {
+      g_cond_wait (&src->read_ahead_cond, &src->read_ahead_lock);
+      continue;
+    }
+    g_mutex_unlock (&src->read_ahead_lock);
+
+    GST_OBJECT_LOCK (src);
+    angle = src->angle;
+    GST_OBJECT_UNLOCK (src);
+
+    do {
+      res = gst_dvd_read_src_read (src, angle, src->change_cell, &buf);
+    } while (res == GST_DVD_READ_AGAIN);
+
+    if (res == GST_DVD_READ_OK) {
+      src->change_cell = FALSE;
+    } else if (buf) {
+      gst_buffer_unref (buf);
+      buf = NULL;
+    }
+
+    entry = g_new0 (GstDvdReadAhead, 1);
+    entry->res = res;
+    entry->buf = buf;
+    entry->clut_event = src->pending_clut_event;
+    src->pending_clut_event = NULL;
+    gst_dvd_read_src_save_position (src, &entry->pos);
+
+    g_mutex_lock (&src->read_ahead_lock);
+    g_queue_push_tail (&src->read_ahead_queue, entry);
+    if (res != GST_DVD_READ_OK)
+      src->read_ahead_done = TRUE;
+    g_cond_broadcast (&src->read_ahead_cond);
+  }
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  return NULL;
+}
+
+/* Stops the read-ahead thread and drops whatever it had read, the next
+ * read continues from where playback is */
+static void
+gst_dvd_read_src_stop_read_ahead (GstDvdReadSrc * src)
+{
+  GstDvdReadAhead *entry;
+
+  if (src->read_ahead_thread == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (src, "stopping read-ahead thread");
+
+  g_mutex_lock (&src->read_ahead_lock);
+  src->read_ahead_quit = TRUE;
+  g_cond_broadcast (&src->read_ahead_cond);
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  g_thread_join (src->read_ahead_thread);
+
+  g_mutex_lock (&src->read_ahead_lock);
+  src->read_ahead_thread = NULL;
+  while ((entry = g_queue_pop_head (&src->read_ahead_queue)))
+    gst_dvd_read_ahead_free (entry);
+  src->read_ahead_quit = FALSE;
+  src->read_ahead_done = FALSE;
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  /* go back to the position after the last VOBU that was pushed */
+  if (src->chapter != src->out_pos.chapter)
+    gst_dvd_read_src_goto_chapter (src, src->out_pos.chapter);
+  src->cur_pack = src->out_pos.pack;
+  src->cur_cell = src->out_pos.cell;
+  src->next_cell = src->out_pos.next_cell;
+  src->new_cell = src->out_pos.new_cell;
+}
+
+static GstDvdReadReturn
+gst_dvd_read_src_read_ahead (GstDvdReadSrc * src, GstBuffer ** p_buf,
+    GstEvent ** p_clut_event)
+{
+  GstDvdReadAhead *entry;
+  GstDvdReadReturn res;
+
+  if (src->read_ahead_thread == NULL) {
+    GST_DEBUG_OBJECT (src, "starting read-ahead thread");
+    g_mutex_lock (&src->read_ahead_lock);
+    gst_dvd_read_src_save_position (src, &src->out_pos);
+    src->read_ahead_thread = g_thread_new ("dvdreadsrc-read-ahead",
+        (GThreadFunc) gst_dvd_read_src_read_ahead_func, src);
+    g_mutex_unlock (&src->read_ahead_lock);
+  }
+
+  g_mutex_lock (&src->read_ahead_lock);
+  if (g_queue_is_empty (&src->read_ahead_queue) && !src->read_ahead_flushing) {
+    src->read_ahead_stalls++;
+    GST_LOG_OBJECT (src, "waiting for read-ahead (stall %u)",
+        src->read_ahead_stalls);
+    while (g_queue_is_empty (&src->read_ahead_queue) &&
+        !src->read_ahead_flushing)
+      g_cond_wait (&src->read_ahead_cond, &src->read_ahead_lock);
+  }
+
+  if (src->read_ahead_flushing) {
+    g_mutex_unlock (&src->read_ahead_lock);
+    return GST_DVD_READ_AGAIN;
+  }
+
+  entry = g_queue_pop_head (&src->read_ahead_queue);
+  if (entry->res == GST_DVD_READ_OK)
+    src->out_pos = entry->pos;
+  g_cond_broadcast (&src->read_ahead_cond);
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  res = entry->res;
+  *p_buf = entry->buf;
+  *p_clut_event = entry->clut_event;
+  g_free (entry);
+
+  return res;
+}
+
 static GstFlowReturn
 gst_dvd_read_src_create (GstPushSrc * pushsrc, GstBuffer ** p_buf)
 {
   GstDvdReadSrc *src = GST_DVD_READ_SRC (pushsrc);
+  GstEvent *clut_event = NULL;
   GstPad *srcpad;
   gint res;
 
@@ -955,6 +1221,9 @@ gst_dvd_read_src_create (GstPushSrc * pushsrc, GstBuffer ** p_buf)
 
   srcpad = GST_BASE_SRC (src)->srcpad;
 
+  if (src->new_seek)
+    gst_dvd_read_src_stop_read_ahead (src);
+
   if (src->need_newsegment) {
     GstSegment seg;
 
@@ -979,15 +1248,30 @@ gst_dvd_read_src_create (GstPushSrc * pushsrc, GstBuffer ** p_buf)
     src->title_lang_event_pending = NULL;
   }
 
-  if (src->pending_clut_event) {
+  if (src->read_ahead_thread == NULL && src->pending_clut_event) {
     gst_pad_push_event (srcpad, src->pending_clut_event);
     src->pending_clut_event = NULL;
   }
 
   /* read it in */
-  do {
-    res = gst_dvd_read_src_read (src, src->angle, src->change_cell, p_buf);
-  } while (res == GST_DVD_READ_AGAIN);
+  if (src->read_ahead_vobus > 0) {
+    res = gst_dvd_read_src_read_ahead (src, p_buf, &clut_event);
+    if (res == GST_DVD_READ_AGAIN)
+      return GST_FLOW_FLUSHING;
+  } else {
+    gst_dvd_read_src_stop_read_ahead (src);
+
+    do {
+      res = gst_dvd_read_src_read (src, src->angle, src->change_cell, p_buf);
+    } while (res == GST_DVD_READ_AGAIN);
+
+    /* with read-ahead, the thread owns change_cell */
+    if (res == GST_DVD_READ_OK)
+      src->change_cell = FALSE;
+  }
+
+  if (clut_event)
+    gst_pad_push_event (srcpad, clut_event);
 
   switch (res) {
     case GST_DVD_READ_ERROR:{
@@ -1006,7 +1290,6 @@ gst_dvd_read_src_create (GstPushSrc * pushsrc, GstBuffer ** p_buf)
       return GST_FLOW_EOS;
     }
     case GST_DVD_READ_OK:{
-      src->change_cell = FALSE;
       return GST_FLOW_OK;
     }
     default:
@@ -1016,6 +1299,31 @@ gst_dvd_read_src_create (GstPushSrc * pushsrc, GstBuffer ** p_buf)
   g_return_val_if_reached (GST_FLOW_EOS);
 }
 
+static gboolean
+gst_dvd_read_src_unlock (GstBaseSrc * basesrc)
+{
+  GstDvdReadSrc *src = GST_DVD_READ_SRC (basesrc);
+
+  g_mutex_lock (&src->read_ahead_lock);
+  src->read_ahead_flushing = TRUE;
+  g_cond_broadcast (&src->read_ahead_cond);
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_dvd_read_src_unlock_stop (GstBaseSrc * basesrc)
+{
+  GstDvdReadSrc *src = GST_DVD_READ_SRC (basesrc);
+
+  g_mutex_lock (&src->read_ahead_lock);
+  src->read_ahead_flushing = FALSE;
+  g_mutex_unlock (&src->read_ahead_lock);
+
+  return TRUE;
+}
+
 static void
 gst_dvd_read_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -1063,6 +1371,12 @@ gst_dvd_read_src_set_property (GObject * object, guint prop_id,
         src->angle = src->uri_angle - 1;
       }
       break;
+    case ARG_READ_AHEAD_VOBUS:
+      g_mutex_lock (&src->read_ahead_lock);
+      src->read_ahead_vobus = g_value_get_int (value);
+      g_cond_broadcast (&src->read_ahead_cond);
+      g_mutex_unlock (&src->read_ahead_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1092,6 +1406,19 @@ gst_dvd_read_src_get_property (GObject * object, guint prop_id, GValue * value,
     case ARG_ANGLE:
       g_value_set_int (value, src->uri_angle);
       break;
+    case ARG_READ_AHEAD_VOBUS:
+      g_value_set_int (value, src->read_ahead_vobus);
+      break;
+    case ARG_READ_AHEAD_LEVEL:
+      g_mutex_lock (&src->read_ahead_lock);
+      g_value_set_int (value, src->read_ahead_queue.length);
+      g_mutex_unlock (&src->read_ahead_lock);
+      break;
+    case ARG_READ_AHEAD_STALLS:
+      g_mutex_lock (&src->read_ahead_lock);
+      g_value_set_uint (value, src->read_ahead_stalls);
+      g_mutex_unlock (&src->read_ahead_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1250,6 +1577,8 @@ gst_dvd_read_src_do_seek (GstBaseSrc * basesrc, GstSegment * s)
   GST_DEBUG_OBJECT (src, "Seeking to %s: %12" G_GINT64_FORMAT,
       gst_format_get_name (s->format), s->position);
 
+  gst_dvd_read_src_stop_read_ahead (src);
+
   /* Ignore the first seek to 0, as it breaks starting playback
    * from another chapter by seeking back to sector 0 */
   if (src->first_seek && s->format == GST_FORMAT_BYTES && s->start == 0) {
@@ -1444,23 +1773,33 @@ gst_dvd_read_src_do_duration_query (GstDvdReadSrc * src, GstQuery * query)
 static gboolean
 gst_dvd_read_src_do_position_query (GstDvdReadSrc * src, GstQuery * query)
 {
+  GstDvdReadPosition pos;
   GstFormat format;
   gint64 val;
 
   gst_query_parse_position (query, &format, NULL);
 
+  /* the read-ahead thread is ahead of what was pushed. It is started with
+   * the lock held, so it can't start moving the read state meanwhile */
+  g_mutex_lock (&src->read_ahead_lock);
+  if (src->read_ahead_thread)
+    pos = src->out_pos;
+  else
+    gst_dvd_read_src_save_position (src, &pos);
+  g_mutex_unlock (&src->read_ahead_lock);
+
   switch (format) {
     case GST_FORMAT_BYTES:{
-      val = (gint64) src->cur_pack * DVD_VIDEO_LB_LEN;
+      val = (gint64) pos.pack * DVD_VIDEO_LB_LEN;
       break;
     }
     default:{
       if (format == sector_format) {
-        val = src->cur_pack;
+        val = pos.pack;
       } else if (format == title_format) {
         val = src->title;
       } else if (format == chapter_format) {
-        val = src->chapter;
+        val = pos.chapter;
       } else if (format == angle_format) {
         val = src->angle;
       } else {
@@ -31,6 +31,8 @@
 #include <dvdread/nav_read.h>
 #include <dvdread/nav_print.h>
 
+#include "dvdreadindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_DVD_READ_SRC            (gst_dvd_read_src_get_type())
@@ -42,6 +44,15 @@ G_BEGIN_DECLS
 typedef struct _GstDvdReadSrc GstDvdReadSrc;
 typedef struct _GstDvdReadSrcClass GstDvdReadSrcClass;
 
+/* read position within the current title */
+typedef struct {
+  gint             pack;
+  gint             cell;
+  gint             next_cell;
+  gboolean         new_cell;
+  gint             chapter;
+} GstDvdReadPosition;
+
 struct _GstDvdReadSrc {
   GstPushSrc       pushsrc;
 
@@ -65,6 +76,7 @@ struct _GstDvdReadSrc {
   gint             start_cell, last_cell, cur_cell;
   gint             cur_pack;
   gint             next_cell;
+  gint             vobu_estimate; /* sectors to read along with NAV packs */
   dvd_reader_t    *dvd;
   ifo_handle_t    *vmg_file;
 
@@ -74,6 +86,9 @@ struct _GstDvdReadSrc {
   ifo_handle_t    *vts_file;
   vts_ptt_srpt_t  *vts_ptt_srpt;
   vts_tmapt_t     *vts_tmapt;
+  GstDvdReadIndexEntry *index_by_time;   /* time map of the title */
+  GstDvdReadIndexEntry *index_by_sector; /* same, sorted by sector */
+  guint            index_len;
   dvd_file_t      *dvd_title;
   gint             num_chapters;
   gint             num_angles;
@@ -88,6 +103,18 @@ struct _GstDvdReadSrc {
   gboolean         need_newsegment;
   GstEvent        *title_lang_event_pending;
   GstEvent        *pending_clut_event;
+
+  /* read-ahead thread, protected by read_ahead_lock */
+  gint             read_ahead_vobus;
+  GThread         *read_ahead_thread;
+  GMutex           read_ahead_lock;
+  GCond            read_ahead_cond;
+  GQueue           read_ahead_queue;
+  gboolean         read_ahead_quit;
+  gboolean         read_ahead_done;
+  gboolean         read_ahead_flushing;
+  guint            read_ahead_stalls;
+  GstDvdReadPosition out_pos;     /* after the last VOBU pushed */
 };
 
 struct _GstDvdReadSrcClass {
@@ -41,6 +41,16 @@ GST_DEBUG_CATEGORY_STATIC (CAT_PERFORMANCE);
  */
 #define WARN_THRESHOLD (5)
 
+#define DEFAULT_DECODE_MODE GST_MPEG2DEC_DECODE_MODE_ALL
+#define DEFAULT_MAX_THREADS 1
+
+enum
+{
+  PROP_0,
+  PROP_DECODE_MODE,
+  PROP_MAX_THREADS
+};
+
 static GstStaticPadTemplate sink_template_factory =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -66,6 +76,10 @@ GST_ELEMENT_REGISTER_DEFINE (mpeg2dec, "mpeg2dec", GST_RANK_SECONDARY,
     GST_TYPE_MPEG2DEC);
 
 static void gst_mpeg2dec_finalize (GObject * object);
+static void gst_mpeg2dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_mpeg2dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 /* GstVideoDecoder base class method */
 static gboolean gst_mpeg2dec_open (GstVideoDecoder * decoder);
@@ -82,9 +96,30 @@ static gboolean gst_mpeg2dec_decide_allocation (GstVideoDecoder * decoder,
     GstQuery * query);
 
 static void gst_mpeg2dec_clear_buffers (GstMpeg2dec * mpeg2dec);
+static GstFlowReturn gst_mpeg2dec_drain_gops (GstMpeg2dec * mpeg2dec,
+    gboolean discard);
 static gboolean gst_mpeg2dec_crop_buffer (GstMpeg2dec * dec,
     GstVideoCodecFrame * in_frame, GstVideoFrame * in_vframe);
 
+#define GST_TYPE_MPEG2DEC_DECODE_MODE (gst_mpeg2dec_decode_mode_get_type())
+static GType
+gst_mpeg2dec_decode_mode_get_type (void)
+{
+  static GType decode_mode_type = 0;
+  static const GEnumValue decode_modes[] = {
+    {GST_MPEG2DEC_DECODE_MODE_ALL, "Decode all pictures", "all"},
+    {GST_MPEG2DEC_DECODE_MODE_KEYFRAMES, "Decode I pictures only",
+        "keyframes"},
+    {0, NULL, NULL},
+  };
+
+  if (!decode_mode_type) {
+    decode_mode_type =
+        g_enum_register_static ("GstMpeg2decDecodeMode", decode_modes);
+  }
+  return decode_mode_type;
+}
+
 static void
 gst_mpeg2dec_class_init (GstMpeg2decClass * klass)
 {
@@ -93,6 +128,39 @@ gst_mpeg2dec_class_init (GstMpeg2decClass * klass)
   GstVideoDecoderClass *video_decoder_class = GST_VIDEO_DECODER_CLASS (klass);
 
   gobject_class->finalize = gst_mpeg2dec_finalize;
+  gobject_class->set_property = gst_mpeg2dec_set_property;
+  gobject_class->get_property = gst_mpeg2dec_get_property;
+
+  /**
+   * GstMpeg2dec:decode-mode
+   *
+   * Which pictures to decode. In keyframes mode, P and B pictures are
+   * skipped without being decoded, which is useful for thumbnailing. The
+   * same happens for segments with the trickmode-key-units flag set.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_DECODE_MODE,
+      g_param_spec_enum ("decode-mode", "Decode mode",
+          "Which pictures to decode", GST_TYPE_MPEG2DEC_DECODE_MODE,
+          DEFAULT_DECODE_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMpeg2dec:max-threads
+   *
+   * Maximum number of threads to decode with. When larger than 1 and the
+   * stream is made of closed GOPs, each GOP is decoded on its own thread.
+   * This adds up to that many GOPs of latency and disables QoS and keyframe
+   * skipping, so it is meant for file playback and transcoding. Streams
+   * with open GOPs are always decoded serially. 0 means one thread per CPU.
+   *
+   * Since: 1.20
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum threads",
+          "Maximum number of GOPs to decode in parallel (0 = automatic)",
+          0, 64, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (element_class,
       &src_template_factory);
@@ -118,11 +186,24 @@ gst_mpeg2dec_class_init (GstMpeg2decClass * klass)
   GST_DEBUG_CATEGORY_INIT (mpeg2dec_debug, "mpeg2dec", 0,
       "MPEG-2 Video Decoder");
   GST_DEBUG_CATEGORY_GET (CAT_PERFORMANCE, "GST_PERFORMANCE");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_MPEG2DEC_DECODE_MODE, 0);
 }
 
 static void
 gst_mpeg2dec_init (GstMpeg2dec * mpeg2dec)
 {
+  guint i;
+
+  for (i = 0; i < GST_MPEG2DEC_MAX_BUFFERS; i++)
+    mpeg2dec->buffers[i].id = -1;
+
+  mpeg2dec->decode_mode = DEFAULT_DECODE_MODE;
+  mpeg2dec->max_threads = DEFAULT_MAX_THREADS;
+  g_mutex_init (&mpeg2dec->gop_lock);
+  g_cond_init (&mpeg2dec->gop_cond);
+  g_queue_init (&mpeg2dec->pending_gops);
+
   gst_video_decoder_set_packetized (GST_VIDEO_DECODER (mpeg2dec), TRUE);
   gst_video_decoder_set_needs_format (GST_VIDEO_DECODER (mpeg2dec), TRUE);
   gst_video_decoder_set_use_default_pad_acceptcaps (GST_VIDEO_DECODER_CAST
@@ -147,9 +228,50 @@ gst_mpeg2dec_finalize (GObject * object)
   g_free (mpeg2dec->dummybuf[3]);
   mpeg2dec->dummybuf[3] = NULL;
 
+  g_mutex_clear (&mpeg2dec->gop_lock);
+  g_cond_clear (&mpeg2dec->gop_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_mpeg2dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMpeg2dec *mpeg2dec = GST_MPEG2DEC (object);
+
+  switch (prop_id) {
+    case PROP_DECODE_MODE:
+      mpeg2dec->decode_mode = g_value_get_enum (value);
+      break;
+    case PROP_MAX_THREADS:
+      mpeg2dec->max_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_mpeg2dec_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstMpeg2dec *mpeg2dec = GST_MPEG2DEC (object);
+
+  switch (prop_id) {
+    case PROP_DECODE_MODE:
+      g_value_set_enum (value, mpeg2dec->decode_mode);
+      break;
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, mpeg2dec->max_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static gboolean
 gst_mpeg2dec_open (GstVideoDecoder * decoder)
 {
@@ -197,6 +319,14 @@ gst_mpeg2dec_start (GstVideoDecoder * decoder)
   GstMpeg2dec *mpeg2dec = GST_MPEG2DEC (decoder);
 
   mpeg2dec->discont_state = MPEG2DEC_DISC_NEW_PICTURE;
+  mpeg2dec->qos_state = MPEG2DEC_QOS_NONE;
+  mpeg2dec->skipping = FALSE;
+
+  mpeg2dec->n_threads = mpeg2dec->max_threads;
+  if (mpeg2dec->n_threads == 0)
+    mpeg2dec->n_threads = g_get_num_processors ();
+  mpeg2dec->parallel = mpeg2dec->n_threads > 1 ?
+      MPEG2DEC_PARALLEL_UNDECIDED : MPEG2DEC_PARALLEL_OFF;
 
   return TRUE;
 }
@@ -211,6 +341,13 @@ gst_mpeg2dec_stop (GstVideoDecoder * decoder)
 
   gst_mpeg2dec_clear_buffers (mpeg2dec);
 
+  gst_mpeg2dec_drain_gops (mpeg2dec, TRUE);
+  if (mpeg2dec->gop_pool) {
+    g_thread_pool_free (mpeg2dec->gop_pool, FALSE, TRUE);
+    mpeg2dec->gop_pool = NULL;
+  }
+  gst_buffer_replace (&mpeg2dec->seq_header, NULL);
+
   if (mpeg2dec->input_state)
     gst_video_codec_state_unref (mpeg2dec->input_state);
   mpeg2dec->input_state = NULL;
@@ -218,6 +355,12 @@ gst_mpeg2dec_stop (GstVideoDecoder * decoder)
   if (mpeg2dec->downstream_pool) {
     gst_buffer_pool_set_active (mpeg2dec->downstream_pool, FALSE);
     gst_object_unref (mpeg2dec->downstream_pool);
+    mpeg2dec->downstream_pool = NULL;
+  }
+
+  if (mpeg2dec->convert) {
+    gst_video_converter_free (mpeg2dec->convert);
+    mpeg2dec->convert = NULL;
   }
 
   return TRUE;
@@ -230,11 +373,17 @@ gst_mpeg2dec_flush (GstVideoDecoder * decoder)
 
   /* reset the initial video state */
   mpeg2dec->discont_state = MPEG2DEC_DISC_NEW_PICTURE;
+  mpeg2dec->qos_state = MPEG2DEC_QOS_NONE;
+  mpeg2dec->skipping = FALSE;
   mpeg2_reset (mpeg2dec->decoder, 1);
   mpeg2_skip (mpeg2dec->decoder, 1);
 
   gst_mpeg2dec_clear_buffers (mpeg2dec);
 
+  gst_mpeg2dec_drain_gops (mpeg2dec, TRUE);
+  if (mpeg2dec->n_threads > 1)
+    mpeg2dec->parallel = MPEG2DEC_PARALLEL_UNDECIDED;
+
   if (mpeg2dec->downstream_pool)
     gst_buffer_pool_set_active (mpeg2dec->downstream_pool, FALSE);
 
@@ -244,7 +393,9 @@ gst_mpeg2dec_flush (GstVideoDecoder * decoder)
 static GstFlowReturn
 gst_mpeg2dec_finish (GstVideoDecoder * decoder)
 {
-  return GST_FLOW_OK;
+  GstMpeg2dec *mpeg2dec = GST_MPEG2DEC (decoder);
+
+  return gst_mpeg2dec_drain_gops (mpeg2dec, FALSE);
 }
 
 static GstBufferPool *
@@ -286,6 +437,11 @@ gst_mpeg2dec_decide_allocation (GstVideoDecoder * decoder, GstQuery * query)
     dec->downstream_pool = NULL;
   }
 
+  if (dec->convert) {
+    gst_video_converter_free (dec->convert);
+    dec->convert = NULL;
+  }
+
   /* Get negotiated allocation caps */
   gst_query_parse_allocation (query, &caps, NULL);
 
@@ -506,8 +662,20 @@ gst_mpeg2dec_crop_buffer (GstMpeg2dec * dec, GstVideoCodecFrame * in_frame,
     gst_buffer_unref (in_frame->output_buffer);
   in_frame->output_buffer = buffer;
 
-  if (!gst_video_frame_copy (&output_frame, input_vframe))
-    goto copy_failed;
+  /* Copy with a converter so that the planes are copied in parallel, this
+   * matters for HD content where every frame has to go through here */
+  if (!dec->convert) {
+    GstStructure *config;
+
+    config = gst_structure_new ("GstVideoConverter",
+        GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, g_get_num_processors (),
+        NULL);
+    dec->convert = gst_video_converter_new (dinfo, info, config);
+    if (!dec->convert)
+      goto copy_failed;
+  }
+
+  gst_video_converter_frame (dec->convert, input_vframe, &output_frame);
 
   gst_video_frame_unmap (&output_frame);
 
@@ -535,21 +703,42 @@ copy_failed:
   }
 }
 
-typedef struct
+#define GST_MPEG2DEC_BUFFER_SLOT(dec, id) \
+  (&(dec)->buffers[(id) & (GST_MPEG2DEC_MAX_BUFFERS - 1)])
+
+static void
+gst_mpeg2dec_release_buffer (GstMpeg2DecBuffer * mbuf)
+{
+  gst_video_frame_unmap (&mbuf->frame);
+  mbuf->id = -1;
+}
+
+static gint
+gst_mpeg2dec_buffer_compare (GstMpeg2DecBuffer * mbuf, gconstpointer id)
 {
-  gint id;
-  GstVideoFrame frame;
-} GstMpeg2DecBuffer;
+  return mbuf->id != GPOINTER_TO_INT (id);
+}
 
 static void
 gst_mpeg2dec_clear_buffers (GstMpeg2dec * mpeg2dec)
 {
   GList *l;
-  while ((l = g_list_first (mpeg2dec->buffers))) {
+  guint i;
+
+  for (i = 0; i < GST_MPEG2DEC_MAX_BUFFERS; i++) {
+    GstMpeg2DecBuffer *mbuf = &mpeg2dec->buffers[i];
+
+    if (mbuf->id != -1)
+      gst_mpeg2dec_release_buffer (mbuf);
+  }
+
+  while ((l = g_list_first (mpeg2dec->overflow_buffers))) {
     GstMpeg2DecBuffer *mbuf = l->data;
-    gst_video_frame_unmap (&mbuf->frame);
+
+    gst_mpeg2dec_release_buffer (mbuf);
     g_slice_free (GstMpeg2DecBuffer, mbuf);
-    mpeg2dec->buffers = g_list_delete_link (mpeg2dec->buffers, l);
+    mpeg2dec->overflow_buffers =
+        g_list_delete_link (mpeg2dec->overflow_buffers, l);
   }
 }
 
@@ -557,53 +746,65 @@ static void
 gst_mpeg2dec_save_buffer (GstMpeg2dec * mpeg2dec, gint id,
     GstVideoFrame * frame)
 {
-  GstMpeg2DecBuffer *mbuf;
+  GstMpeg2DecBuffer *mbuf = GST_MPEG2DEC_BUFFER_SLOT (mpeg2dec, id);
 
   GST_LOG_OBJECT (mpeg2dec, "Saving local info for frame %d", id);
 
-  mbuf = g_slice_new0 (GstMpeg2DecBuffer);
+  /* frame numbers also advance for input that produced no picture, so the
+   * slot may still hold a picture libmpeg2 references. Keep the new one on
+   * the side then */
+  if (mbuf->id != -1) {
+    GST_DEBUG_OBJECT (mpeg2dec, "Slot of frame %d still used by frame %d",
+        id, mbuf->id);
+    mbuf = g_slice_new (GstMpeg2DecBuffer);
+    mpeg2dec->overflow_buffers =
+        g_list_prepend (mpeg2dec->overflow_buffers, mbuf);
+  }
+
   mbuf->id = id;
   mbuf->frame = *frame;
-
-  mpeg2dec->buffers = g_list_prepend (mpeg2dec->buffers, mbuf);
-}
-
-static gint
-gst_mpeg2dec_buffer_compare (GstMpeg2DecBuffer * mbuf, gconstpointer id)
-{
-  if (mbuf->id == GPOINTER_TO_INT (id))
-    return 0;
-  return -1;
 }
 
 static void
 gst_mpeg2dec_discard_buffer (GstMpeg2dec * mpeg2dec, gint id)
 {
-  GList *l = g_list_find_custom (mpeg2dec->buffers, GINT_TO_POINTER (id),
-      (GCompareFunc) gst_mpeg2dec_buffer_compare);
+  GstMpeg2DecBuffer *mbuf = GST_MPEG2DEC_BUFFER_SLOT (mpeg2dec, id);
+
+  GList *l;
 
+  if (mbuf->id == id) {
+    gst_mpeg2dec_release_buffer (mbuf);
+    GST_LOG_OBJECT (mpeg2dec, "Discarded local info for frame %d", id);
+    return;
+  }
+
+  l = g_list_find_custom (mpeg2dec->overflow_buffers, GINT_TO_POINTER (id),
+      (GCompareFunc) gst_mpeg2dec_buffer_compare);
   if (l) {
-    GstMpeg2DecBuffer *mbuf = l->data;
-    gst_video_frame_unmap (&mbuf->frame);
+    mbuf = l->data;
+    gst_mpeg2dec_release_buffer (mbuf);
     g_slice_free (GstMpeg2DecBuffer, mbuf);
-    mpeg2dec->buffers = g_list_delete_link (mpeg2dec->buffers, l);
+    mpeg2dec->overflow_buffers =
+        g_list_delete_link (mpeg2dec->overflow_buffers, l);
     GST_LOG_OBJECT (mpeg2dec, "Discarded local info for frame %d", id);
   } else {
-    GST_WARNING ("Could not find buffer %d, will be leaked until next reset",
-        id);
+    GST_WARNING_OBJECT (mpeg2dec, "Could not find buffer %d", id);
   }
 }
 
 static GstVideoFrame *
 gst_mpeg2dec_get_buffer (GstMpeg2dec * mpeg2dec, gint id)
 {
-  GList *l = g_list_find_custom (mpeg2dec->buffers, GINT_TO_POINTER (id),
-      (GCompareFunc) gst_mpeg2dec_buffer_compare);
+  GstMpeg2DecBuffer *mbuf = GST_MPEG2DEC_BUFFER_SLOT (mpeg2dec, id);
+  GList *l;
 
-  if (l) {
-    GstMpeg2DecBuffer *mbuf = l->data;
+  if (mbuf->id == id)
     return &mbuf->frame;
-  }
+
+  l = g_list_find_custom (mpeg2dec->overflow_buffers, GINT_TO_POINTER (id),
+      (GCompareFunc) gst_mpeg2dec_buffer_compare);
+  if (l)
+    return &((GstMpeg2DecBuffer *) l->data)->frame;
 
   return NULL;
 }
@@ -624,18 +825,34 @@ init_dummybuf (GstMpeg2dec * mpeg2dec)
       GST_VIDEO_INFO_PLANE_OFFSET (&mpeg2dec->decoded_info, 2);
 }
 
+static GstVideoFormat
+gst_mpeg2dec_get_format (const mpeg2_sequence_t * sequence)
+{
+  /* get subsampling */
+  if (sequence->chroma_width < sequence->width) {
+    /* horizontally subsampled */
+    if (sequence->chroma_height < sequence->height) {
+      /* and vertically subsamples */
+      return GST_VIDEO_FORMAT_I420;
+    } else {
+      return GST_VIDEO_FORMAT_Y42B;
+    }
+  } else {
+    /* not subsampled */
+    return GST_VIDEO_FORMAT_Y444;
+  }
+}
+
 static GstFlowReturn
-handle_sequence (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info)
+gst_mpeg2dec_set_sequence (GstMpeg2dec * mpeg2dec,
+    const mpeg2_sequence_t * sequence)
 {
   GstFlowReturn ret = GST_FLOW_OK;
   GstClockTime latency;
-  const mpeg2_sequence_t *sequence;
   GstVideoCodecState *state;
   GstVideoInfo *vinfo;
   GstVideoFormat format;
 
-  sequence = info->sequence;
-
   if (sequence->frame_period == 0)
     goto invalid_frame_period;
 
@@ -667,20 +884,14 @@ handle_sequence (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info)
     goto invalid_picture;
   }
 
-  /* get subsampling */
-  if (sequence->chroma_width < sequence->width) {
-    /* horizontally subsampled */
-    if (sequence->chroma_height < sequence->height) {
-      /* and vertically subsamples */
-      format = GST_VIDEO_FORMAT_I420;
-    } else {
-      format = GST_VIDEO_FORMAT_Y42B;
-    }
-  } else {
-    /* not subsampled */
-    format = GST_VIDEO_FORMAT_Y444;
+  /* Pictures decoded GOP-parallel are copied out without padding */
+  if (mpeg2dec->parallel == MPEG2DEC_PARALLEL_ON) {
+    gst_video_alignment_reset (&mpeg2dec->valign);
+    mpeg2dec->need_alignment = FALSE;
   }
 
+  format = gst_mpeg2dec_get_format (sequence);
+
   state = gst_video_decoder_set_output_state (GST_VIDEO_DECODER (mpeg2dec),
       format, sequence->picture_width, sequence->picture_height,
       mpeg2dec->input_state);
@@ -804,13 +1015,20 @@ handle_sequence (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info)
       sequence->flags & SEQ_FLAG_LOW_DELAY,
       sequence->flags & SEQ_FLAG_COLOUR_DESCRIPTION);
 
+  if (mpeg2dec->convert) {
+    gst_video_converter_free (mpeg2dec->convert);
+    mpeg2dec->convert = NULL;
+  }
+
   /* Save the padded video information */
   mpeg2dec->decoded_info = *vinfo;
   gst_video_info_align (&mpeg2dec->decoded_info, &mpeg2dec->valign);
 
   /* Mpeg2dec has 2 frame latency to produce a picture and 1 frame latency in
    * it's parser */
-  latency = gst_util_uint64_scale (3 * GST_SECOND, vinfo->fps_d, vinfo->fps_n);
+  mpeg2dec->frame_duration =
+      gst_util_uint64_scale (GST_SECOND, vinfo->fps_d, vinfo->fps_n);
+  latency = 3 * mpeg2dec->frame_duration;
   gst_video_decoder_set_latency (GST_VIDEO_DECODER (mpeg2dec), latency,
       latency);
 
@@ -819,17 +1037,6 @@ handle_sequence (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info)
 
   gst_video_codec_state_unref (state);
 
-  mpeg2_custom_fbuf (mpeg2dec->decoder, 1);
-
-  init_dummybuf (mpeg2dec);
-
-  /* Pump in some null buffers, because otherwise libmpeg2 doesn't
-   * initialise the discard_fbuf->id */
-  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
-  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
-  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
-  gst_mpeg2dec_clear_buffers (mpeg2dec);
-
   return ret;
 
 invalid_frame_period:
@@ -861,6 +1068,105 @@ negotiation_fail:
   }
 }
 
+static GstFlowReturn
+handle_sequence (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info)
+{
+  GstFlowReturn ret;
+
+  ret = gst_mpeg2dec_set_sequence (mpeg2dec, info->sequence);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  mpeg2_custom_fbuf (mpeg2dec->decoder, 1);
+
+  init_dummybuf (mpeg2dec);
+
+  /* Pump in some null buffers, because otherwise libmpeg2 doesn't
+   * initialise the discard_fbuf->id */
+  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
+  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
+  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
+  gst_mpeg2dec_clear_buffers (mpeg2dec);
+
+  return GST_FLOW_OK;
+}
+
+/* Decide whether the picture about to be decoded can be skipped because
+ * downstream reported that we are running late. B pictures are skipped as
+ * soon as they are late since nothing references them. When we are more
+ * than the decoder latency behind, P pictures are skipped as well, along
+ * with everything depending on them, until the next I picture. */
+static gboolean
+gst_mpeg2dec_qos_skip_picture (GstMpeg2dec * mpeg2dec,
+    const mpeg2_info_t * info, GstVideoCodecFrame * frame, gint type)
+{
+  GstClockTimeDiff max_decode_time;
+
+  switch (type) {
+    case PIC_FLAG_CODING_TYPE_I:
+      /* The B pictures following an I picture in an open GOP still
+       * reference the last P picture we skipped */
+      if (mpeg2dec->qos_state == MPEG2DEC_QOS_SKIP_TO_KEYFRAME) {
+        if (info->gop && (info->gop->flags & GOP_FLAG_CLOSED_GOP))
+          mpeg2dec->qos_state = MPEG2DEC_QOS_NONE;
+        else
+          mpeg2dec->qos_state = MPEG2DEC_QOS_SKIP_LEADING_B;
+      }
+      return FALSE;
+    case PIC_FLAG_CODING_TYPE_P:
+      if (mpeg2dec->qos_state == MPEG2DEC_QOS_SKIP_TO_KEYFRAME)
+        return TRUE;
+      mpeg2dec->qos_state = MPEG2DEC_QOS_NONE;
+      break;
+    case PIC_FLAG_CODING_TYPE_B:
+      if (mpeg2dec->qos_state != MPEG2DEC_QOS_NONE)
+        return TRUE;
+      break;
+    default:
+      return FALSE;
+  }
+
+  max_decode_time =
+      gst_video_decoder_get_max_decode_time (GST_VIDEO_DECODER (mpeg2dec),
+      frame);
+  if (max_decode_time >= 0)
+    return FALSE;
+
+  if (type == PIC_FLAG_CODING_TYPE_B)
+    return TRUE;
+
+  if (-max_decode_time > 3 * mpeg2dec->frame_duration) {
+    GST_DEBUG_OBJECT (mpeg2dec, "late by %" GST_STIME_FORMAT
+        ", skipping to next keyframe", GST_STIME_ARGS (-max_decode_time));
+    mpeg2dec->qos_state = MPEG2DEC_QOS_SKIP_TO_KEYFRAME;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Let libmpeg2 skip the slices of the current picture and hand it the dummy
+ * buffer, no output buffer is needed for a picture that will never be
+ * displayed */
+static void
+gst_mpeg2dec_skip_picture (GstMpeg2dec * mpeg2dec)
+{
+  mpeg2_skip (mpeg2dec->decoder, 1);
+  mpeg2dec->skipping = TRUE;
+  mpeg2_stride (mpeg2dec->decoder,
+      GST_VIDEO_INFO_PLANE_STRIDE (&mpeg2dec->decoded_info, 0));
+  mpeg2_set_buf (mpeg2dec->decoder, mpeg2dec->dummybuf, NULL);
+}
+
+static gboolean
+gst_mpeg2dec_keyframes_only (GstMpeg2dec * mpeg2dec)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (mpeg2dec);
+
+  return mpeg2dec->decode_mode == GST_MPEG2DEC_DECODE_MODE_KEYFRAMES ||
+      (decoder->input_segment.flags & GST_SEGMENT_FLAG_TRICKMODE_KEY_UNITS);
+}
+
 static GstFlowReturn
 handle_picture (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info,
     GstVideoCodecFrame * frame)
@@ -874,15 +1180,12 @@ handle_picture (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info,
   GstVideoFrame vframe;
   guint8 *buf[3];
 
-  ret = gst_video_decoder_allocate_output_frame (decoder, frame);
-  if (ret != GST_FLOW_OK)
-    return ret;
-
   type = picture->flags & PIC_MASK_CODING_TYPE;
   switch (type) {
     case PIC_FLAG_CODING_TYPE_I:
       key_frame = TRUE;
       mpeg2_skip (mpeg2dec->decoder, 0);
+      mpeg2dec->skipping = FALSE;
       type_str = "I";
       break;
     case PIC_FLAG_CODING_TYPE_P:
@@ -899,6 +1202,28 @@ handle_picture (GstMpeg2dec * mpeg2dec, const mpeg2_info_t * info,
       return ret;
   }
 
+  if (!key_frame && gst_mpeg2dec_keyframes_only (mpeg2dec)) {
+    GST_DEBUG_OBJECT (mpeg2dec, "skipping %s picture, frame %i, keyframes only",
+        type_str, frame->system_frame_number);
+    gst_mpeg2dec_skip_picture (mpeg2dec);
+    gst_video_codec_frame_ref (frame);
+    gst_video_decoder_release_frame (decoder, frame);
+    return GST_FLOW_OK;
+  } else if (gst_mpeg2dec_qos_skip_picture (mpeg2dec, info, frame, type)) {
+    GST_DEBUG_OBJECT (mpeg2dec, "skipping %s picture, frame %i, too late",
+        type_str, frame->system_frame_number);
+    gst_mpeg2dec_skip_picture (mpeg2dec);
+    gst_video_codec_frame_ref (frame);
+    return gst_video_decoder_drop_frame (decoder, frame);
+  } else if (mpeg2dec->skipping) {
+    mpeg2_skip (mpeg2dec->decoder, 0);
+    mpeg2dec->skipping = FALSE;
+  }
+
+  ret = gst_video_decoder_allocate_output_frame (decoder, frame);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
   GST_DEBUG_OBJECT (mpeg2dec, "handle picture type %s", type_str);
   GST_DEBUG_OBJECT (mpeg2dec, "picture %s, frame %i",
       key_frame ? ", kf," : "    ", frame->system_frame_number);
@@ -1039,6 +1364,514 @@ no_frame:
   }
 }
 
+/* GOP-parallel decoding
+ *
+ * libmpeg2 is single-threaded. For streams made of closed GOPs, every GOP can
+ * be decoded independently, so the input is split at GOP headers and each
+ * GOP is decoded by its own libmpeg2 instance on a worker thread. Up to
+ * n_threads GOPs are in flight at once, and they are finished in order from
+ * the streaming thread. Pictures are copied out of libmpeg2's own frame
+ * buffers, cropped to the display size, into buffers of the negotiated pool
+ * when its format matches.
+ */
+struct _GstMpeg2decGop
+{
+  /* sequence header to feed first, if the GOP does not start with one */
+  GstBuffer *seq_header;
+  /* GstVideoCodecFrame, in decoding order */
+  GPtrArray *frames;
+  /* GstMpeg2decPicture, in display order */
+  GArray *pictures;
+
+  mpeg2_sequence_t sequence;
+  gboolean have_sequence;
+  gboolean done;
+
+  /* output pool at the time the GOP was queued, may be NULL */
+  GstBufferPool *pool;
+  GstVideoInfo pool_info;
+};
+
+typedef struct
+{
+  guint index;
+  GstBuffer *buffer;
+} GstMpeg2decPicture;
+
+static GstMpeg2decGop *
+gst_mpeg2dec_gop_new (GstMpeg2dec * mpeg2dec, gboolean has_seq_header)
+{
+  GstMpeg2decGop *gop = g_slice_new0 (GstMpeg2decGop);
+
+  if (!has_seq_header && mpeg2dec->seq_header)
+    gop->seq_header = gst_buffer_ref (mpeg2dec->seq_header);
+  gop->frames = g_ptr_array_new ();
+  gop->pictures = g_array_new (FALSE, FALSE, sizeof (GstMpeg2decPicture));
+
+  return gop;
+}
+
+static void
+gst_mpeg2dec_gop_free (GstMpeg2decGop * gop)
+{
+  guint i;
+
+  for (i = 0; i < gop->frames->len; i++) {
+    GstVideoCodecFrame *frame = g_ptr_array_index (gop->frames, i);
+
+    if (frame)
+      gst_video_codec_frame_unref (frame);
+  }
+  for (i = 0; i < gop->pictures->len; i++) {
+    GstMpeg2decPicture *pic =
+        &g_array_index (gop->pictures, GstMpeg2decPicture, i);
+
+    if (pic->buffer)
+      gst_buffer_unref (pic->buffer);
+  }
+  g_ptr_array_free (gop->frames, TRUE);
+  g_array_free (gop->pictures, TRUE);
+  if (gop->seq_header)
+    gst_buffer_unref (gop->seq_header);
+  if (gop->pool)
+    gst_object_unref (gop->pool);
+  g_slice_free (GstMpeg2decGop, gop);
+}
+
+/* Scans the headers preceding the first picture of @data. Returns TRUE if a
+ * GOP header was found and sets @closed accordingly. The location of the
+ * sequence header, if any, is returned in @seq_offset and @seq_size. */
+static gboolean
+gst_mpeg2dec_scan_gop_header (const guint8 * data, gsize size,
+    gboolean * closed, gsize * seq_offset, gsize * seq_size)
+{
+  gboolean have_gop = FALSE;
+  gssize seq_start = -1;
+  gsize i;
+
+  *seq_size = 0;
+
+  for (i = 0; i + 4 <= size; i++) {
+    guint8 code;
+
+    if (data[i] != 0x00 || data[i + 1] != 0x00 || data[i + 2] != 0x01)
+      continue;
+
+    code = data[i + 3];
+
+    /* extensions and user data are part of the sequence header */
+    if (seq_start >= 0 && code != 0xb5 && code != 0xb2) {
+      *seq_offset = seq_start;
+      *seq_size = i - seq_start;
+      seq_start = -1;
+    }
+
+    switch (code) {
+      case 0xb3:
+        seq_start = i;
+        break;
+      case 0xb8:
+        if (i + 8 <= size) {
+          have_gop = TRUE;
+          *closed = (data[i + 7] & 0x40) != 0;
+        }
+        break;
+      case 0x00:
+        /* picture header, we are done with the headers */
+        return have_gop;
+      default:
+        break;
+    }
+    i += 3;
+  }
+
+  return have_gop;
+}
+
+static GstBuffer *
+gst_mpeg2dec_gop_alloc (GstMpeg2decGop * gop, const GstVideoInfo * vinfo)
+{
+  GstBuffer *buffer = NULL;
+
+  if (gop->pool &&
+      GST_VIDEO_INFO_FORMAT (&gop->pool_info) == GST_VIDEO_INFO_FORMAT (vinfo)
+      && GST_VIDEO_INFO_WIDTH (&gop->pool_info) == GST_VIDEO_INFO_WIDTH (vinfo)
+      && GST_VIDEO_INFO_HEIGHT (&gop->pool_info) ==
+      GST_VIDEO_INFO_HEIGHT (vinfo)) {
+    if (gst_buffer_pool_acquire_buffer (gop->pool, &buffer,
+            NULL) != GST_FLOW_OK)
+      buffer = NULL;
+  }
+
+  if (buffer == NULL)
+    buffer = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (vinfo), NULL);
+
+  return buffer;
+}
+
+static void
+gst_mpeg2dec_gop_output (GstMpeg2decGop * gop, const mpeg2_info_t * info)
+{
+  const mpeg2_sequence_t *sequence = info->sequence;
+  const mpeg2_picture_t *picture = info->display_picture;
+  GstMpeg2decPicture pic;
+  GstVideoInfo vinfo;
+  GstVideoFrame vframe;
+  guint i;
+  gint line;
+
+  if (!(picture->flags & PIC_FLAG_TAGS) || picture->tag == 0
+      || picture->tag > gop->frames->len)
+    return;
+
+  gst_video_info_set_format (&vinfo, gst_mpeg2dec_get_format (sequence),
+      sequence->picture_width, sequence->picture_height);
+
+  pic.index = picture->tag - 1;
+  pic.buffer = gst_mpeg2dec_gop_alloc (gop, &vinfo);
+
+  /* the video meta of pool buffers, if any, describes their layout */
+  if (!gst_video_frame_map (&vframe, &vinfo, pic.buffer, GST_MAP_WRITE)) {
+    gst_buffer_unref (pic.buffer);
+    return;
+  }
+
+  /* libmpeg2 uses the coded width as stride for its own frame buffers */
+  for (i = 0; i < 3; i++) {
+    const guint8 *src = info->display_fbuf->buf[i];
+    guint8 *dest = GST_VIDEO_FRAME_COMP_DATA (&vframe, i);
+    gint src_stride = i == 0 ? sequence->width : sequence->chroma_width;
+    gint dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, i);
+    gint width = GST_VIDEO_FRAME_COMP_WIDTH (&vframe, i);
+    gint height = GST_VIDEO_FRAME_COMP_HEIGHT (&vframe, i);
+
+    for (line = 0; line < height; line++) {
+      memcpy (dest, src, width);
+      src += src_stride;
+      dest += dest_stride;
+    }
+  }
+
+  gst_video_frame_unmap (&vframe);
+
+  if (!(sequence->flags & SEQ_FLAG_PROGRESSIVE_SEQUENCE)) {
+    if (picture->flags & PIC_FLAG_TOP_FIELD_FIRST)
+      GST_BUFFER_FLAG_SET (pic.buffer, GST_VIDEO_BUFFER_FLAG_TFF);
+    if (!(picture->flags & PIC_FLAG_PROGRESSIVE_FRAME))
+      GST_BUFFER_FLAG_SET (pic.buffer, GST_VIDEO_BUFFER_FLAG_INTERLACED);
+    if (picture->flags & PIC_FLAG_REPEAT_FIRST_FIELD)
+      GST_BUFFER_FLAG_SET (pic.buffer, GST_VIDEO_BUFFER_FLAG_RFF);
+  }
+
+  g_array_append_val (gop->pictures, pic);
+}
+
+static void
+gst_mpeg2dec_gop_parse (GstMpeg2decGop * gop, mpeg2dec_t * decoder,
+    const guint8 * data, gsize size)
+{
+  const mpeg2_info_t *info = mpeg2_info (decoder);
+  mpeg2_state_t state;
+
+  mpeg2_buffer (decoder, (guint8 *) data, (guint8 *) data + size);
+
+  while ((state = mpeg2_parse (decoder)) != STATE_BUFFER) {
+    switch (state) {
+      case STATE_SEQUENCE:
+      case STATE_SEQUENCE_MODIFIED:
+        gop->sequence = *info->sequence;
+        gop->have_sequence = TRUE;
+        break;
+      case STATE_SLICE:
+      case STATE_END:
+      case STATE_INVALID_END:
+        if (info->display_fbuf && info->display_picture)
+          gst_mpeg2dec_gop_output (gop, info);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static void
+gst_mpeg2dec_decode_gop (GstMpeg2decGop * gop, GstMpeg2dec * mpeg2dec)
+{
+  static const guint8 sequence_end[] = { 0x00, 0x00, 0x01, 0xb7 };
+  mpeg2dec_t *decoder;
+  GstMapInfo minfo;
+  guint i;
+
+  decoder = mpeg2_init ();
+  if (decoder == NULL)
+    goto done;
+
+  if (gop->seq_header && gst_buffer_map (gop->seq_header, &minfo,
+          GST_MAP_READ)) {
+    gst_mpeg2dec_gop_parse (gop, decoder, minfo.data, minfo.size);
+    gst_buffer_unmap (gop->seq_header, &minfo);
+  }
+
+  for (i = 0; i < gop->frames->len; i++) {
+    GstVideoCodecFrame *frame = g_ptr_array_index (gop->frames, i);
+
+    if (!gst_buffer_map (frame->input_buffer, &minfo, GST_MAP_READ))
+      continue;
+
+    /* Tag the picture with the index of its frame, 0 means no tag */
+    mpeg2_tag_picture (decoder, i + 1, 0);
+    gst_mpeg2dec_gop_parse (gop, decoder, minfo.data, minfo.size);
+    gst_buffer_unmap (frame->input_buffer, &minfo);
+  }
+
+  /* Terminate the sequence to get the last reference picture out */
+  gst_mpeg2dec_gop_parse (gop, decoder, sequence_end, sizeof (sequence_end));
+
+  mpeg2_close (decoder);
+
+done:
+  g_mutex_lock (&mpeg2dec->gop_lock);
+  gop->done = TRUE;
+  g_cond_broadcast (&mpeg2dec->gop_cond);
+  g_mutex_unlock (&mpeg2dec->gop_lock);
+}
+
+static void
+gst_mpeg2dec_wait_gop (GstMpeg2dec * mpeg2dec, GstMpeg2decGop * gop)
+{
+  g_mutex_lock (&mpeg2dec->gop_lock);
+  while (!gop->done)
+    g_cond_wait (&mpeg2dec->gop_cond, &mpeg2dec->gop_lock);
+  g_mutex_unlock (&mpeg2dec->gop_lock);
+}
+
+/* Waits for @gop to be decoded and pushes its pictures, consumes @gop */
+static GstFlowReturn
+gst_mpeg2dec_finish_gop (GstMpeg2dec * mpeg2dec, GstMpeg2decGop * gop)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (mpeg2dec);
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean update_latency = FALSE;
+  guint i;
+
+  gst_mpeg2dec_wait_gop (mpeg2dec, gop);
+
+  if (gop->have_sequence && (!mpeg2dec->have_gop_sequence ||
+          memcmp (&gop->sequence, &mpeg2dec->gop_sequence,
+              sizeof (mpeg2_sequence_t)) != 0)) {
+    mpeg2dec->gop_sequence = gop->sequence;
+    mpeg2dec->have_gop_sequence = TRUE;
+
+    ret = gst_mpeg2dec_set_sequence (mpeg2dec, &gop->sequence);
+    if (ret == GST_FLOW_ERROR) {
+      mpeg2dec->have_gop_sequence = FALSE;
+      GST_VIDEO_DECODER_ERROR (decoder, 1, STREAM, DECODE,
+          ("decoding error"), ("Bad sequence header"), ret);
+    }
+    /* setting the sequence resets the latency to the serial one */
+    update_latency = TRUE;
+  }
+
+  /* Pictures come out once the next n_threads GOPs have started, on top of
+   * the latency of libmpeg2 itself */
+  if (gop->frames->len > mpeg2dec->max_gop_len) {
+    mpeg2dec->max_gop_len = gop->frames->len;
+    update_latency = TRUE;
+  }
+  if (update_latency && mpeg2dec->have_gop_sequence) {
+    GstClockTime latency = (3 + (mpeg2dec->n_threads + 1) *
+        mpeg2dec->max_gop_len) * mpeg2dec->frame_duration;
+
+    GST_DEBUG_OBJECT (mpeg2dec, "latency %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (latency));
+    gst_video_decoder_set_latency (decoder, latency, latency);
+  }
+
+  for (i = 0; i < gop->pictures->len; i++) {
+    GstMpeg2decPicture *pic =
+        &g_array_index (gop->pictures, GstMpeg2decPicture, i);
+    GstVideoCodecFrame *frame = g_ptr_array_index (gop->frames, pic->index);
+
+    if (!frame || ret != GST_FLOW_OK || !mpeg2dec->have_gop_sequence)
+      continue;
+
+    g_ptr_array_index (gop->frames, pic->index) = NULL;
+    frame->output_buffer = pic->buffer;
+    pic->buffer = NULL;
+
+    ret = gst_video_decoder_finish_frame (decoder, frame);
+  }
+
+  /* Frames that did not produce a picture */
+  for (i = 0; i < gop->frames->len; i++) {
+    GstVideoCodecFrame *frame = g_ptr_array_index (gop->frames, i);
+
+    if (frame) {
+      g_ptr_array_index (gop->frames, i) = NULL;
+      gst_video_decoder_release_frame (decoder, frame);
+    }
+  }
+
+  gst_mpeg2dec_gop_free (gop);
+
+  return ret;
+}
+
+static void
+gst_mpeg2dec_push_gop (GstMpeg2dec * mpeg2dec)
+{
+  GstMpeg2decGop *gop = mpeg2dec->current_gop;
+
+  if (!gop)
+    return;
+
+  gop->pool = gst_video_decoder_get_buffer_pool (GST_VIDEO_DECODER (mpeg2dec));
+  if (gop->pool) {
+    GstStructure *config = gst_buffer_pool_get_config (gop->pool);
+    GstCaps *caps = NULL;
+
+    if (!gst_buffer_pool_config_get_params (config, &caps, NULL, NULL, NULL)
+        || caps == NULL || !gst_video_info_from_caps (&gop->pool_info, caps)) {
+      gst_object_unref (gop->pool);
+      gop->pool = NULL;
+    }
+    gst_structure_free (config);
+  }
+
+  g_queue_push_tail (&mpeg2dec->pending_gops, mpeg2dec->current_gop);
+  g_thread_pool_push (mpeg2dec->gop_pool, mpeg2dec->current_gop, NULL);
+  mpeg2dec->current_gop = NULL;
+}
+
+/* Pushes out all pending GOPs, or throws them away if @discard is TRUE */
+static GstFlowReturn
+gst_mpeg2dec_drain_gops (GstMpeg2dec * mpeg2dec, gboolean discard)
+{
+  GstMpeg2decGop *gop;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (discard && mpeg2dec->current_gop) {
+    gst_mpeg2dec_gop_free (mpeg2dec->current_gop);
+    mpeg2dec->current_gop = NULL;
+  }
+
+  gst_mpeg2dec_push_gop (mpeg2dec);
+
+  while ((gop = g_queue_pop_head (&mpeg2dec->pending_gops))) {
+    if (discard || ret != GST_FLOW_OK) {
+      gst_mpeg2dec_wait_gop (mpeg2dec, gop);
+      gst_mpeg2dec_gop_free (gop);
+    } else {
+      ret = gst_mpeg2dec_finish_gop (mpeg2dec, gop);
+    }
+  }
+
+  return ret;
+}
+
+/* Returns TRUE in @handled if @frame was taken care of, FALSE if it should
+ * go through the serial decoder */
+static GstFlowReturn
+gst_mpeg2dec_handle_frame_parallel (GstMpeg2dec * mpeg2dec,
+    GstVideoCodecFrame * frame, gboolean * handled)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (mpeg2dec);
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstMapInfo minfo;
+  gboolean have_gop, closed = FALSE;
+  gsize seq_offset = 0, seq_size;
+
+  *handled = FALSE;
+
+  if (!gst_buffer_map (frame->input_buffer, &minfo, GST_MAP_READ))
+    return GST_FLOW_OK;
+  have_gop = gst_mpeg2dec_scan_gop_header (minfo.data, minfo.size, &closed,
+      &seq_offset, &seq_size);
+  gst_buffer_unmap (frame->input_buffer, &minfo);
+
+  if (seq_size > 0) {
+    if (mpeg2dec->seq_header)
+      gst_buffer_unref (mpeg2dec->seq_header);
+    mpeg2dec->seq_header = gst_buffer_copy_region (frame->input_buffer,
+        GST_BUFFER_COPY_MEMORY, seq_offset, seq_size);
+  }
+
+  if (mpeg2dec->parallel == MPEG2DEC_PARALLEL_UNDECIDED) {
+    if (!have_gop || !closed) {
+      GST_DEBUG_OBJECT (mpeg2dec, "no closed GOP, decoding serially");
+      mpeg2dec->parallel = MPEG2DEC_PARALLEL_OFF;
+      return GST_FLOW_OK;
+    }
+
+    GST_DEBUG_OBJECT (mpeg2dec, "decoding GOPs with %u threads",
+        mpeg2dec->n_threads);
+    mpeg2dec->parallel = MPEG2DEC_PARALLEL_ON;
+    mpeg2dec->have_gop_sequence = FALSE;
+    mpeg2dec->max_gop_len = 0;
+    if (!mpeg2dec->gop_pool) {
+      mpeg2dec->gop_pool =
+          g_thread_pool_new ((GFunc) gst_mpeg2dec_decode_gop, mpeg2dec,
+          mpeg2dec->n_threads, FALSE, NULL);
+    }
+  } else if (have_gop && !closed) {
+    /* Open GOPs can't be decoded on their own, decode the rest of the stream
+     * serially. The serial decoder starts afresh at this GOP, so its leading
+     * B pictures are lost as after a seek */
+    GST_DEBUG_OBJECT (mpeg2dec, "open GOP, switching to serial decoding");
+    ret = gst_mpeg2dec_drain_gops (mpeg2dec, FALSE);
+    mpeg2dec->parallel = MPEG2DEC_PARALLEL_OFF;
+
+    mpeg2dec->discont_state = MPEG2DEC_DISC_NEW_PICTURE;
+    mpeg2_reset (mpeg2dec->decoder, 1);
+    mpeg2_skip (mpeg2dec->decoder, 1);
+
+    /* The sequence header has to go through the normal parsing so that the
+     * serial decoder sets up its buffers and padding again, prepend it if
+     * this GOP doesn't repeat it */
+    if (ret == GST_FLOW_OK && seq_size == 0 && mpeg2dec->seq_header) {
+      GstBuffer *buf;
+
+      buf = gst_buffer_append (gst_buffer_copy (mpeg2dec->seq_header),
+          gst_buffer_ref (frame->input_buffer));
+      gst_buffer_copy_into (buf, frame->input_buffer,
+          GST_BUFFER_COPY_METADATA, 0, -1);
+      gst_buffer_unref (frame->input_buffer);
+      frame->input_buffer = buf;
+    }
+
+    if (ret != GST_FLOW_OK) {
+      *handled = TRUE;
+      gst_video_decoder_release_frame (decoder, frame);
+    }
+    return ret;
+  }
+
+  *handled = TRUE;
+
+  if (have_gop) {
+    gst_mpeg2dec_push_gop (mpeg2dec);
+
+    while (ret == GST_FLOW_OK &&
+        g_queue_get_length (&mpeg2dec->pending_gops) > mpeg2dec->n_threads) {
+      ret = gst_mpeg2dec_finish_gop (mpeg2dec,
+          g_queue_pop_head (&mpeg2dec->pending_gops));
+    }
+
+    mpeg2dec->current_gop = gst_mpeg2dec_gop_new (mpeg2dec, seq_size > 0);
+  }
+
+  if (!mpeg2dec->current_gop) {
+    GST_DEBUG_OBJECT (mpeg2dec, "no GOP started yet, dropping frame");
+    gst_video_decoder_release_frame (decoder, frame);
+    return ret;
+  }
+
+  /* The GOP keeps our reference to the frame */
+  g_ptr_array_add (mpeg2dec->current_gop->frames, frame);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_mpeg2dec_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame)
@@ -1056,6 +1889,17 @@ gst_mpeg2dec_handle_frame (GstVideoDecoder * decoder,
       frame->system_frame_number,
       GST_TIME_ARGS (frame->pts), GST_TIME_ARGS (frame->duration));
 
+  if (mpeg2dec->parallel != MPEG2DEC_PARALLEL_OFF) {
+    gboolean handled;
+
+    ret = gst_mpeg2dec_handle_frame_parallel (mpeg2dec, frame, &handled);
+    if (handled)
+      return ret;
+
+    /* the input may have been extended with the sequence header */
+    buf = frame->input_buffer;
+  }
+
   gst_buffer_ref (buf);
   if (!gst_buffer_map (buf, &minfo, GST_MAP_READ)) {
     GST_ERROR_OBJECT (mpeg2dec, "Failed to map input buffer");
@@ -46,6 +46,12 @@ G_BEGIN_DECLS
 typedef struct _GstMpeg2dec GstMpeg2dec;
 typedef struct _GstMpeg2decClass GstMpeg2decClass;
 
+/* Upper bound on the number of decoded pictures libmpeg2 can keep a
+ * reference to at any given time (two reference pictures, the picture being
+ * decoded and the one being displayed) plus the input frames that can be
+ * queued in between. Must be a power of two as it is used as a mask. */
+#define GST_MPEG2DEC_MAX_BUFFERS 32
+
 typedef enum
 {
   MPEG2DEC_DISC_NONE            = 0,
@@ -53,14 +59,45 @@ typedef enum
   MPEG2DEC_DISC_NEW_KEYFRAME
 } DiscontState;
 
+typedef enum
+{
+  GST_MPEG2DEC_DECODE_MODE_ALL = 0,
+  GST_MPEG2DEC_DECODE_MODE_KEYFRAMES
+} GstMpeg2decDecodeMode;
+
+typedef enum
+{
+  MPEG2DEC_QOS_NONE             = 0,
+  MPEG2DEC_QOS_SKIP_TO_KEYFRAME,
+  MPEG2DEC_QOS_SKIP_LEADING_B
+} QosState;
+
+typedef enum
+{
+  MPEG2DEC_PARALLEL_UNDECIDED   = 0,
+  MPEG2DEC_PARALLEL_ON,
+  MPEG2DEC_PARALLEL_OFF
+} ParallelState;
+
+typedef struct _GstMpeg2decGop GstMpeg2decGop;
+
+typedef struct
+{
+  gint id;
+  GstVideoFrame frame;
+} GstMpeg2DecBuffer;
+
 struct _GstMpeg2dec {
   GstVideoDecoder element;
 
   mpeg2dec_t    *decoder;
   const mpeg2_info_t *info;
 
-  /* Buffer lifetime management */
-  GList         *buffers;
+  /* Buffer lifetime management, indexed by system_frame_number modulo
+   * GST_MPEG2DEC_MAX_BUFFERS. Unused slots have an id of -1. Buffers whose
+   * slot is still in use go to overflow_buffers */
+  GstMpeg2DecBuffer buffers[GST_MPEG2DEC_MAX_BUFFERS];
+  GList *overflow_buffers;
 
   /* FIXME This should not be necessary. It is used to prevent image
    * corruption when the parser does not behave the way it should.
@@ -68,14 +105,36 @@ struct _GstMpeg2dec {
    */
   DiscontState   discont_state;
 
+  GstMpeg2decDecodeMode decode_mode;
+
+  /* QoS and trick mode picture skipping */
+  QosState       qos_state;
+  gboolean       skipping;
+  GstClockTime   frame_duration;
+
   /* video state */
   GstVideoCodecState *input_state;
   GstVideoInfo        decoded_info;
   GstVideoAlignment   valign;
   GstBufferPool *     downstream_pool;
   gboolean            need_alignment;
+  GstVideoConverter * convert;
 
   guint8        *dummybuf[4];
+
+  /* GOP-parallel decoding */
+  guint          max_threads;
+  guint          n_threads;
+  ParallelState  parallel;
+  GThreadPool   *gop_pool;
+  GMutex         gop_lock;
+  GCond          gop_cond;
+  GQueue         pending_gops;
+  GstMpeg2decGop *current_gop;
+  GstBuffer     *seq_header;
+  mpeg2_sequence_t gop_sequence;
+  gboolean       have_gop_sequence;
+  guint          max_gop_len;
 };
 
 struct _GstMpeg2decClass {
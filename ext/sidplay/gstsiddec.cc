@@ -28,7 +28,10 @@
  * This plugin will first load the complete program into memory before starting
  * the emulator and producing output.
  *
- * Seeking is not (and cannot be) implemented.
+ * Seeking is implemented by running the emulator without output up to the
+ * seek position, in the streaming thread. The emulator state can't be saved,
+ * so seeking backwards restarts the tune from the beginning, and seeking far
+ * into a tune may take a while before output resumes.
  *
  * ## Example pipelines
  *
@@ -54,6 +57,12 @@
 #define DEFAULT_FORCE_SPEED	FALSE
 #define DEFAULT_BLOCKSIZE	4096
 
+/* size of the buffer the emulator output is discarded into when seeking */
+#define SEEK_BUFFER_SIZE	65536
+/* bytes emulated per iteration of the streaming task while seeking, so that
+ * another seek or a state change doesn't have to wait for all of it */
+#define SEEK_STEP_SIZE		(16 * SEEK_BUFFER_SIZE)
+
 enum
 {
   PROP_0,
@@ -242,6 +251,9 @@ gst_siddec_init (GstSidDec * siddec)
   siddec->tune_number = 0;
   siddec->total_bytes = 0;
   siddec->blocksize = DEFAULT_BLOCKSIZE;
+  gst_segment_init (&siddec->segment, GST_FORMAT_TIME);
+  siddec->seek_bytes = -1;
+  siddec->seek_seqnum = GST_SEQNUM_INVALID;
 
   siddec->have_group_id = FALSE;
   siddec->group_id = G_MAXUINT;
@@ -391,6 +403,77 @@ invalid_format:
   }
 }
 
+/* runs the emulator without output from the current position towards
+ * @bytes, restarting the tune if that's before the current position. Stops
+ * after SEEK_STEP_SIZE bytes, the caller continues until total_bytes got
+ * there */
+static gboolean
+gst_siddec_skip_to (GstSidDec * siddec, guint64 bytes)
+{
+  guint8 *discard;
+  guint64 end;
+
+  if (bytes < siddec->total_bytes) {
+    GST_DEBUG_OBJECT (siddec, "restarting tune");
+    if (!sidEmuInitializeSong (*siddec->engine, *siddec->tune,
+            siddec->tune_number))
+      return FALSE;
+    siddec->total_bytes = 0;
+  }
+
+  GST_LOG_OBJECT (siddec, "skipping from byte %" G_GUINT64_FORMAT " to %"
+      G_GUINT64_FORMAT, siddec->total_bytes, bytes);
+
+  end = MIN (bytes, siddec->total_bytes + SEEK_STEP_SIZE);
+  discard = (guint8 *) g_malloc (SEEK_BUFFER_SIZE);
+  while (siddec->total_bytes < end) {
+    guint size = (guint) MIN (end - siddec->total_bytes, SEEK_BUFFER_SIZE);
+
+    sidEmuFillBuffer (*siddec->engine, *siddec->tune, discard, size);
+    siddec->total_bytes += size;
+  }
+  g_free (discard);
+
+  return TRUE;
+}
+
+/* continues a pending seek. Returns GST_FLOW_OK once the seek position is
+ * reached and the new segment was sent, GST_FLOW_CUSTOM_SUCCESS while there
+ * is more to skip */
+static GstFlowReturn
+gst_siddec_do_pending_seek (GstSidDec * siddec)
+{
+  GstFormat time_format = GST_FORMAT_TIME;
+  GstEvent *event;
+  gint64 start_time;
+
+  if (!gst_siddec_skip_to (siddec, (guint64) siddec->seek_bytes)) {
+    GST_ELEMENT_ERROR (siddec, LIBRARY, INIT,
+        ("Could not initialize song"), ("Could not initialize song"));
+    return GST_FLOW_ERROR;
+  }
+
+  if (siddec->total_bytes < (guint64) siddec->seek_bytes)
+    return GST_FLOW_CUSTOM_SUCCESS;
+
+  GST_DEBUG_OBJECT (siddec, "reached seek position %" G_GINT64_FORMAT,
+      siddec->seek_bytes);
+  siddec->seek_bytes = -1;
+
+  gst_siddec_src_convert (siddec->srcpad, GST_FORMAT_BYTES,
+      siddec->total_bytes, &time_format, &start_time);
+  siddec->segment.start = start_time;
+  siddec->segment.time = start_time;
+  siddec->segment.position = start_time;
+
+  event = gst_event_new_segment (&siddec->segment);
+  if (siddec->seek_seqnum != GST_SEQNUM_INVALID)
+    gst_event_set_seqnum (event, siddec->seek_seqnum);
+  gst_pad_push_event (siddec->srcpad, event);
+
+  return GST_FLOW_OK;
+}
+
 static void
 play_loop (GstPad * pad)
 {
@@ -403,6 +486,16 @@ play_loop (GstPad * pad)
 
   siddec = GST_SIDDEC (gst_pad_get_parent (pad));
 
+  /* the task runs with the stream lock held, which also protects the
+   * seek fields */
+  if (siddec->seek_bytes >= 0) {
+    ret = gst_siddec_do_pending_seek (siddec);
+    if (ret == GST_FLOW_CUSTOM_SUCCESS)
+      goto done;
+    if (ret != GST_FLOW_OK)
+      goto seek_failed;
+  }
+
   out = gst_buffer_new_and_alloc (siddec->blocksize);
 
   gst_buffer_map (out, &outmap, GST_MAP_WRITE);
@@ -422,6 +515,13 @@ play_loop (GstPad * pad)
           GST_FORMAT_BYTES, siddec->total_bytes, &format, &time))
     GST_BUFFER_TIMESTAMP (out) = time;
 
+  if (GST_CLOCK_TIME_IS_VALID (siddec->segment.stop) &&
+      time >= (gint64) siddec->segment.stop) {
+    gst_buffer_unref (out);
+    ret = GST_FLOW_EOS;
+    goto pause;
+  }
+
   /* update position and get new timestamp to calculate duration */
   siddec->total_bytes += siddec->blocksize;
 
@@ -461,13 +561,19 @@ pause:
     gst_pad_pause_task (pad);
     goto done;
   }
+seek_failed:
+  {
+    /* already posted an error */
+    gst_pad_push_event (pad, gst_event_new_eos ());
+    gst_pad_pause_task (pad);
+    goto done;
+  }
 }
 
 static gboolean
 start_play_tune (GstSidDec * siddec)
 {
   gboolean res;
-  GstSegment segment;
 
   if (!siddec->tune->load (siddec->tune_buffer, siddec->tune_len))
     goto could_not_load;
@@ -481,9 +587,11 @@ start_play_tune (GstSidDec * siddec)
           siddec->tune_number))
     goto could_not_init;
 
-  gst_segment_init (&segment, GST_FORMAT_TIME);
-  gst_pad_push_event (siddec->srcpad, gst_event_new_segment (&segment));
+  gst_segment_init (&siddec->segment, GST_FORMAT_TIME);
+  gst_pad_push_event (siddec->srcpad, gst_event_new_segment (&siddec->segment));
   siddec->total_bytes = 0;
+  siddec->seek_bytes = -1;
+  siddec->seek_seqnum = GST_SEQNUM_INVALID;
   siddec->have_group_id = FALSE;
   siddec->group_id = G_MAXUINT;
 
@@ -643,12 +751,106 @@ gst_siddec_src_convert (GstPad * pad, GstFormat src_format, gint64 src_value,
   return res;
 }
 
+/* Only sets up the seek, the emulator is run up to the new position by the
+ * streaming task, see gst_siddec_do_pending_seek() */
+static gboolean
+gst_siddec_do_seek (GstSidDec * siddec, GstEvent * event)
+{
+  gdouble rate;
+  GstFormat format, bytes_format = GST_FORMAT_BYTES;
+  GstFormat time_format = GST_FORMAT_TIME;
+  GstSeekFlags flags;
+  GstSeekType start_type, stop_type;
+  gint64 start, stop, bytes;
+  gboolean flush;
+  gint bytes_per_sample;
+  guint32 seqnum;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
+      &stop_type, &stop);
+  seqnum = gst_event_get_seqnum (event);
+
+  /* the tune has not been loaded yet */
+  if (GST_PAD_TASK (siddec->srcpad) == NULL)
+    goto not_playing;
+
+  /* the emulator only runs forward at its own pace */
+  if (rate != 1.0 || start_type != GST_SEEK_TYPE_SET)
+    goto unsupported;
+
+  if (!gst_siddec_src_convert (siddec->srcpad, format, start, &bytes_format,
+          &bytes))
+    goto unsupported;
+  if (stop_type == GST_SEEK_TYPE_SET && stop != -1 &&
+      !gst_siddec_src_convert (siddec->srcpad, format, stop, &time_format,
+          &stop))
+    goto unsupported;
+
+  /* align to whole samples */
+  bytes_per_sample =
+      (siddec->config->bitsPerSample >> 3) * siddec->config->channels;
+  bytes -= bytes % bytes_per_sample;
+
+  flush = (flags & GST_SEEK_FLAG_FLUSH) != 0;
+
+  if (flush) {
+    GstEvent *flush_event = gst_event_new_flush_start ();
+
+    gst_event_set_seqnum (flush_event, seqnum);
+    gst_pad_push_event (siddec->srcpad, flush_event);
+  } else {
+    gst_pad_pause_task (siddec->srcpad);
+  }
+
+  GST_PAD_STREAM_LOCK (siddec->srcpad);
+
+  if (flush) {
+    GstEvent *flush_event = gst_event_new_flush_stop (TRUE);
+
+    gst_event_set_seqnum (flush_event, seqnum);
+    gst_pad_push_event (siddec->srcpad, flush_event);
+  }
+
+  GST_DEBUG_OBJECT (siddec, "seeking to byte %" G_GINT64_FORMAT, bytes);
+
+  gst_segment_init (&siddec->segment, GST_FORMAT_TIME);
+  if (stop_type == GST_SEEK_TYPE_SET && stop != -1)
+    siddec->segment.stop = stop;
+  siddec->seek_bytes = bytes;
+  siddec->seek_seqnum = seqnum;
+
+  gst_pad_start_task (siddec->srcpad,
+      (GstTaskFunction) play_loop, siddec->srcpad, NULL);
+
+  GST_PAD_STREAM_UNLOCK (siddec->srcpad);
+
+  return TRUE;
+
+  /* ERRORS */
+not_playing:
+  {
+    GST_DEBUG_OBJECT (siddec, "cannot seek before the tune is loaded");
+    return FALSE;
+  }
+unsupported:
+  {
+    GST_DEBUG_OBJECT (siddec, "unsupported seek");
+    return FALSE;
+  }
+}
+
 static gboolean
 gst_siddec_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
+  GstSidDec *siddec;
   gboolean res = FALSE;
 
+  siddec = GST_SIDDEC (parent);
+
   switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEEK:
+      res = gst_siddec_do_seek (siddec, event);
+      break;
     default:
       break;
   }
@@ -681,6 +883,19 @@ gst_siddec_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
       }
       break;
     }
+    case GST_QUERY_SEEKING:
+    {
+      GstFormat format;
+
+      gst_query_parse_seeking (query, &format, NULL, NULL, NULL);
+      if (format == GST_FORMAT_TIME || format == GST_FORMAT_DEFAULT ||
+          format == GST_FORMAT_BYTES) {
+        gst_query_set_seeking (query, format, TRUE, 0, -1);
+      } else {
+        gst_query_set_seeking (query, format, FALSE, -1, -1);
+      }
+      break;
+    }
     default:
       res = gst_pad_query_default (pad, parent, query);
       break;
@@ -56,6 +56,9 @@ struct _GstSidDec {
   gint           tune_len;
   gint           tune_number;
   guint64        total_bytes;
+  GstSegment     segment;
+  gint64         seek_bytes;    /* pending seek target, -1 if none */
+  guint32        seek_seqnum;
 
   emuEngine     *engine;
   sidTune       *tune;
@@ -63,6 +63,7 @@ G_DEFINE_TYPE (GstDvdLpcmDec, gst_dvdlpcmdec, GST_TYPE_AUDIO_DECODER);
 GST_ELEMENT_REGISTER_DEFINE (dvdlpcmdec, "dvdlpcmdec", GST_RANK_PRIMARY,
     GST_TYPE_DVDLPCMDEC);
 
+static gboolean gst_dvdlpcmdec_stop (GstAudioDecoder * bdec);
 static gboolean gst_dvdlpcmdec_set_format (GstAudioDecoder * bdec,
     GstCaps * caps);
 static GstFlowReturn gst_dvdlpcmdec_parse (GstAudioDecoder * bdec,
@@ -82,6 +83,7 @@ gst_dvdlpcmdec_class_init (GstDvdLpcmDecClass * klass)
   element_class = (GstElementClass *) klass;
   gstbase_class = (GstAudioDecoderClass *) klass;
 
+  gstbase_class->stop = GST_DEBUG_FUNCPTR (gst_dvdlpcmdec_stop);
   gstbase_class->set_format = GST_DEBUG_FUNCPTR (gst_dvdlpcmdec_set_format);
   gstbase_class->parse = GST_DEBUG_FUNCPTR (gst_dvdlpcmdec_parse);
   gstbase_class->handle_frame = GST_DEBUG_FUNCPTR (gst_dvdlpcmdec_handle_frame);
@@ -129,6 +131,27 @@ gst_dvdlpcmdec_init (GstDvdLpcmDec * dvdlpcmdec)
       GST_DEBUG_FUNCPTR (gst_dvdlpcmdec_chain));
 }
 
+static void
+gst_dvdlpcmdec_clear_pool (GstDvdLpcmDec * dvdlpcmdec)
+{
+  if (dvdlpcmdec->pool) {
+    gst_buffer_pool_set_active (dvdlpcmdec->pool, FALSE);
+    gst_object_unref (dvdlpcmdec->pool);
+    dvdlpcmdec->pool = NULL;
+  }
+  dvdlpcmdec->pool_size = 0;
+}
+
+static gboolean
+gst_dvdlpcmdec_stop (GstAudioDecoder * bdec)
+{
+  GstDvdLpcmDec *dvdlpcmdec = GST_DVDLPCMDEC (bdec);
+
+  gst_dvdlpcmdec_clear_pool (dvdlpcmdec);
+
+  return TRUE;
+}
+
 static const GstAudioChannelPosition channel_positions[][8] = {
   {GST_AUDIO_CHANNEL_POSITION_MONO},
   {GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT,
@@ -253,6 +276,11 @@ gst_dvdlpcmdec_set_output_format (GstDvdLpcmDec * dvdlpcmdec)
   if (res) {
     GST_DEBUG_OBJECT (dvdlpcmdec, "Successfully set output format");
 
+    /* output buffers get allocated from what downstream picks, if
+     * negotiating fails here it is retried when pushing */
+    gst_audio_decoder_negotiate (GST_AUDIO_DECODER (dvdlpcmdec));
+    gst_dvdlpcmdec_clear_pool (dvdlpcmdec);
+
     gst_dvdlpcmdec_send_tags (dvdlpcmdec);
   } else {
     GST_DEBUG_OBJECT (dvdlpcmdec, "Failed to set output format");
@@ -284,12 +312,23 @@ gst_dvdlpcmdec_update_audio_formats (GstDvdLpcmDec * dec, gint channels,
     gst_audio_info_set_format (&dec->info, format, rate, channels,
         sorted_position);
     if (memcmp (position, sorted_position,
-            channels * sizeof (position[0])) != 0)
+            channels * sizeof (position[0])) != 0) {
       dec->lpcm_layout = position;
-    else
+      gst_audio_get_channel_reorder_map (channels, position, sorted_position,
+          dec->reorder_map);
+    } else {
       dec->lpcm_layout = NULL;
+    }
   } else {
     gst_audio_info_set_format (&dec->info, format, rate, channels, NULL);
+    dec->lpcm_layout = NULL;
+  }
+
+  if (dec->lpcm_layout == NULL) {
+    guint c;
+
+    for (c = 0; c < G_N_ELEMENTS (dec->reorder_map); c++)
+      dec->reorder_map[c] = c;
   }
 }
 
@@ -468,8 +507,10 @@ gst_dvdlpcmdec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     if (off + len > size)
       goto bad_first_access;
 
-    subbuf = gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, off, len);
-    GST_BUFFER_TIMESTAMP (subbuf) = GST_CLOCK_TIME_NONE;
+    /* all sub-buffers share the memory of the packet, and only the first
+     * one keeps its flags */
+    subbuf = gst_buffer_copy_region (buf,
+        GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_MEMORY, off, len);
     ret = dvdlpcmdec->base_chain (pad, parent, subbuf);
     if (ret != GST_FLOW_OK)
       goto done;
@@ -482,12 +523,10 @@ gst_dvdlpcmdec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
         len);
 
     if (len > 0) {
-      GstMemory *header, *tmp;
-      subbuf = gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, off, len);
-      tmp = gst_buffer_peek_memory (buf, 0);
-      header = gst_memory_copy (tmp, 2, 3);
-      gst_buffer_prepend_memory (subbuf, header);
-      GST_BUFFER_TIMESTAMP (subbuf) = GST_BUFFER_TIMESTAMP (buf);
+      /* the 3 byte header again, followed by the rest of the packet */
+      subbuf = gst_buffer_copy_region (buf,
+          GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_MEMORY, 2, 3);
+      gst_buffer_copy_into (subbuf, buf, GST_BUFFER_COPY_MEMORY, off, len);
 
       ret = dvdlpcmdec->base_chain (pad, parent, subbuf);
     }
@@ -495,9 +534,12 @@ gst_dvdlpcmdec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     GST_LOG_OBJECT (dvdlpcmdec,
         "Creating single sub-buffer off %d, len %" G_GSIZE_FORMAT, off,
         size - off);
-    subbuf = gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, off, size - off);
-    GST_BUFFER_TIMESTAMP (subbuf) = GST_BUFFER_TIMESTAMP (buf);
-    ret = dvdlpcmdec->base_chain (pad, parent, subbuf);
+    /* trim the packet in place, no need for a new buffer */
+    buf = gst_buffer_make_writable (buf);
+    gst_buffer_resize (buf, off, size - off);
+    ret = dvdlpcmdec->base_chain (pad, parent, buf);
+    /* buf was handed on, nothing to release */
+    return ret;
   }
 
 done:
@@ -832,6 +874,114 @@ gst_dvdlpcmdec_parse (GstAudioDecoder * bdec, GstAdapter * adapter,
   return GST_FLOW_ERROR;
 }
 
+/* Packets vary in size, so the pool buffers are made big enough for the
+ * largest seen so far and trimmed to what is needed */
+static GstBuffer *
+gst_dvdlpcmdec_alloc_output (GstDvdLpcmDec * dvdlpcmdec, gsize size)
+{
+  GstBuffer *outbuf = NULL;
+
+  if (dvdlpcmdec->pool && dvdlpcmdec->pool_size < size)
+    gst_dvdlpcmdec_clear_pool (dvdlpcmdec);
+
+  if (!dvdlpcmdec->pool) {
+    GstAllocator *allocator;
+    GstAllocationParams params;
+    GstStructure *config;
+
+    gst_audio_decoder_get_allocator (GST_AUDIO_DECODER (dvdlpcmdec),
+        &allocator, &params);
+
+    dvdlpcmdec->pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (dvdlpcmdec->pool);
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, allocator, &params);
+    if (allocator)
+      gst_object_unref (allocator);
+
+    if (!gst_buffer_pool_set_config (dvdlpcmdec->pool, config) ||
+        !gst_buffer_pool_set_active (dvdlpcmdec->pool, TRUE)) {
+      GST_WARNING_OBJECT (dvdlpcmdec, "failed to set up buffer pool");
+      gst_object_unref (dvdlpcmdec->pool);
+      dvdlpcmdec->pool = NULL;
+      return gst_audio_decoder_allocate_output_buffer (GST_AUDIO_DECODER
+          (dvdlpcmdec), size);
+    }
+    dvdlpcmdec->pool_size = size;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (dvdlpcmdec->pool, &outbuf,
+          NULL) != GST_FLOW_OK)
+    return NULL;
+
+  gst_buffer_set_size (outbuf, size);
+
+  return outbuf;
+}
+
+/* Copy 16-bit samples, moving each channel to its position in GStreamer
+ * order. The input may be unaligned, hence the byte copies. */
+static void
+gst_dvdlpcmdec_reorder_16 (guint8 * dest, const guint8 * src, guint samples,
+    gint channels, const gint * reorder_map)
+{
+  guint i;
+  gint c;
+
+  for (i = 0; i < samples; i++) {
+    for (c = 0; c < channels; c++) {
+      dest[2 * reorder_map[c]] = src[2 * c];
+      dest[2 * reorder_map[c] + 1] = src[2 * c + 1];
+    }
+    src += 2 * channels;
+    dest += 2 * channels;
+  }
+}
+
+/* 20 and 24-bit LPCM comes in groups of 4 samples: the top 16 bits of each
+ * sample first, then the remaining bits of all 4. Unpack @n_samples of them
+ * to S24BE (with 0x0 in the lowest nibble for 20 bits), storing each sample
+ * at its channel's position in GStreamer order right away. */
+static void
+gst_dvdlpcmdec_unpack (guint8 * dest, const guint8 * src, guint n_samples,
+    gint width, gint channels, const gint * reorder_map)
+{
+  guint8 *frame = dest;
+  guint8 low[4];
+  guint k, j, n;
+  gint c = 0;
+
+  for (k = 0; k < n_samples; k += 4) {
+    if (width == 24) {
+      low[0] = src[8];
+      low[1] = src[9];
+      low[2] = src[10];
+      low[3] = src[11];
+    } else {
+      low[0] = src[8] & 0xf0;
+      low[1] = (src[8] & 0x0f) << 4;
+      low[2] = src[9] & 0xf0;
+      low[3] = (src[9] & 0x0f) << 4;
+    }
+
+    n = MIN (4, n_samples - k);
+    for (j = 0; j < n; j++) {
+      guint8 *d = frame + 3 * reorder_map[c];
+
+      d[0] = src[2 * j];
+      d[1] = src[2 * j + 1];
+      d[2] = low[j];
+
+      if (++c == channels) {
+        c = 0;
+        frame += 3 * channels;
+      }
+    }
+
+    src += (width == 24) ? 12 : 10;
+  }
+}
+
 static GstFlowReturn
 gst_dvdlpcmdec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buf)
 {
@@ -862,104 +1012,60 @@ gst_dvdlpcmdec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buf)
   switch (dvdlpcmdec->width) {
     case 16:
     {
-      /* We can just pass 16-bits straight through intact, once we set
-       * appropriate things on the buffer */
       samples = size / channels / 2;
       if (samples < 1)
         goto drop;
 
-      gst_buffer_ref (buf);
-      break;
-    }
-    case 20:
-    {
-      /* Allocate a new buffer and copy 20-bit width to 24-bit */
-      gint64 samples = size * 8 / 20;
-      gint64 count = size / 10;
-      gint64 i;
-      GstMapInfo srcmap, destmap;
-      guint8 *src;
-      guint8 *dest;
-      GstBuffer *outbuf;
-
-      if (samples < 1)
-        goto drop;
-
-      outbuf = gst_buffer_new_allocate (NULL, samples * 3, NULL);
-      gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
-
-      /* adjust samples so we can calc the new timestamp */
-      samples = samples / channels;
-
-      gst_buffer_map (buf, &srcmap, GST_MAP_READ);
-      gst_buffer_map (outbuf, &destmap, GST_MAP_WRITE);
-      src = srcmap.data;
-      dest = destmap.data;
-
-      /* Copy 20-bit LPCM format to 24-bit buffers, with 0x00 in the lowest
-       * nibble. Note that the first 2 bytes are already correct */
-      for (i = 0; i < count; i++) {
-        dest[0] = src[0];
-        dest[1] = src[1];
-        dest[2] = src[8] & 0xf0;
-        dest[3] = src[2];
-        dest[4] = src[3];
-        dest[5] = (src[8] & 0x0f) << 4;
-        dest[6] = src[4];
-        dest[7] = src[5];
-        dest[8] = src[9] & 0x0f;
-        dest[9] = src[6];
-        dest[10] = src[7];
-        dest[11] = (src[9] & 0x0f) << 4;
-
-        src += 10;
-        dest += 12;
+      if (dvdlpcmdec->lpcm_layout) {
+        /* Copy into the output and reorder in the same pass. Making the
+         * input writable would copy it anyway, as upstream holds on to it */
+        GstMapInfo srcmap, destmap;
+        GstBuffer *outbuf;
+
+        outbuf = gst_dvdlpcmdec_alloc_output (dvdlpcmdec,
+            samples * channels * 2);
+        if (!outbuf)
+          goto no_buffer;
+        gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+        gst_buffer_map (buf, &srcmap, GST_MAP_READ);
+        gst_buffer_map (outbuf, &destmap, GST_MAP_WRITE);
+        gst_dvdlpcmdec_reorder_16 (destmap.data, srcmap.data, samples,
+            channels, dvdlpcmdec->reorder_map);
+        gst_buffer_unmap (outbuf, &destmap);
+        gst_buffer_unmap (buf, &srcmap);
+        buf = outbuf;
+      } else {
+        /* We can just pass 16-bits straight through intact, once we set
+         * appropriate things on the buffer */
+        gst_buffer_ref (buf);
       }
-      gst_buffer_unmap (outbuf, &destmap);
-      gst_buffer_unmap (buf, &srcmap);
-      buf = outbuf;
       break;
     }
+    case 20:
     case 24:
     {
-      /* Rearrange 24-bit LPCM format in-place. Note that the first 2
-       * and last byte are already correct */
-      guint count = size / 12;
-      gint i;
+      /* Allocate a new buffer and unpack to 24-bit, reordering on the way */
+      guint group_size = dvdlpcmdec->width == 24 ? 12 : 10;
+      guint groups = size / group_size;
       GstMapInfo srcmap, destmap;
-      guint8 *src, *dest;
       GstBuffer *outbuf;
 
-      samples = size / channels / 3;
-
+      /* only whole frames */
+      samples = groups * 4 / channels;
       if (samples < 1)
         goto drop;
 
-      outbuf = gst_buffer_new_allocate (NULL, size, NULL);
+      outbuf = gst_dvdlpcmdec_alloc_output (dvdlpcmdec,
+          samples * channels * 3);
+      if (!outbuf)
+        goto no_buffer;
       gst_buffer_copy_into (outbuf, buf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
 
       gst_buffer_map (buf, &srcmap, GST_MAP_READ);
-      gst_buffer_map (outbuf, &destmap, GST_MAP_READWRITE);
-      src = srcmap.data;
-      dest = destmap.data;
-
-      for (i = 0; i < count; i++) {
-        dest[0] = src[0];
-        dest[1] = src[1];
-        dest[11] = src[11];
-        dest[10] = src[7];
-        dest[7] = src[5];
-        dest[5] = src[9];
-        dest[9] = src[6];
-        dest[6] = src[4];
-        dest[4] = src[3];
-        dest[3] = src[2];
-        dest[2] = src[8];
-        dest[8] = src[10];
-
-        src += 12;
-        dest += 12;
-      }
+      gst_buffer_map (outbuf, &destmap, GST_MAP_WRITE);
+      gst_dvdlpcmdec_unpack (destmap.data, srcmap.data, samples * channels,
+          dvdlpcmdec->width, channels, dvdlpcmdec->reorder_map);
       gst_buffer_unmap (outbuf, &destmap);
       gst_buffer_unmap (buf, &srcmap);
       buf = outbuf;
@@ -969,13 +1075,6 @@ gst_dvdlpcmdec_handle_frame (GstAudioDecoder * bdec, GstBuffer * buf)
       goto invalid_width;
   }
 
-  if (dvdlpcmdec->lpcm_layout) {
-    buf = gst_buffer_make_writable (buf);
-    gst_audio_buffer_reorder_channels (buf, dvdlpcmdec->info.finfo->format,
-        dvdlpcmdec->info.channels, dvdlpcmdec->lpcm_layout,
-        dvdlpcmdec->info.position);
-  }
-
   ret = gst_audio_decoder_finish_frame (bdec, buf, 1);
 
 done:
@@ -989,6 +1088,13 @@ drop:
     ret = GST_FLOW_OK;
     goto done;
   }
+no_buffer:
+  {
+    GST_ELEMENT_ERROR (dvdlpcmdec, RESOURCE, FAILED, (NULL),
+        ("Failed to allocate output buffer"));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
 not_negotiated:
   {
     GST_ELEMENT_ERROR (dvdlpcmdec, STREAM, FORMAT, (NULL),
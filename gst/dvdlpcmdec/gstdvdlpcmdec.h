@@ -59,12 +59,16 @@ struct _GstDvdLpcmDec {
 
   GstAudioInfo info;
   const GstAudioChannelPosition *lpcm_layout;
+  gint reorder_map[8];
   gint width;
   gint dynamic_range;
   gint emphasis;
   gint mute;
 
   GstClockTime timestamp;
+
+  GstBufferPool *pool;
+  gsize pool_size;
 };
 
 struct _GstDvdLpcmDecClass {
@@ -44,8 +44,8 @@ static gboolean gst_dvd_sub_dec_handle_dvd_event (GstDvdSubDec * dec,
     GstEvent * event);
 static void gst_dvd_sub_dec_finalize (GObject * gobject);
 static void gst_setup_palette (GstDvdSubDec * dec);
-static void gst_dvd_sub_dec_merge_title (GstDvdSubDec * dec,
-    GstVideoFrame * frame);
+static void gst_dvd_sub_dec_clip_title (GstDvdSubDec * dec);
+static void gst_dvd_sub_dec_decode_bitmap (GstDvdSubDec * dec);
 static GstClockTime gst_dvd_sub_dec_get_event_delay (GstDvdSubDec * dec);
 static gboolean gst_dvd_sub_dec_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
@@ -58,6 +58,9 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("video/x-raw, format = (string) { AYUV, ARGB },"
+        "width = (int) 720, height = (int) 576, framerate = (fraction) 0/1; "
+        "video/x-raw(" GST_CAPS_FEATURE_META_GST_VIDEO_OVERLAY_COMPOSITION "), "
+        "format = (string) AYUV, "
         "width = (int) 720, height = (int) 576, framerate = (fraction) 0/1")
     );
 
@@ -91,28 +94,39 @@ static const guint32 default_clut[16] = {
 typedef struct RLE_state
 {
   gint id;
-  gint aligned;
-  gint offset[2];
-  gint hl_left;
-  gint hl_right;
-
-  guchar *target;
-
-  guchar next;
+  /* read position of each field, in nibbles */
+  guint pos[2];
 }
 RLE_state;
 
+/* Number of nibbles in an RLE code, indexed by its first byte */
+static guint8 rle_code_nibbles[256];
+
 static void
 gst_dvd_sub_dec_class_init (GstDvdSubDecClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
+  gint i;
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
 
   gobject_class->finalize = gst_dvd_sub_dec_finalize;
 
+  /* codes are 4 bits for runs of 1-3, 8 bits up to 15, 12 bits up to 63 and
+   * 16 bits for longer runs and fills till the end of the line */
+  for (i = 0; i < 256; i++) {
+    if (i >= 0x40)
+      rle_code_nibbles[i] = 1;
+    else if (i >= 0x10)
+      rle_code_nibbles[i] = 2;
+    else if (i >= 0x04)
+      rle_code_nibbles[i] = 3;
+    else
+      rle_code_nibbles[i] = 4;
+  }
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class,
       &subtitle_template);
@@ -162,7 +176,9 @@ gst_dvd_sub_dec_init (GstDvdSubDec * dec)
   dec->next_event_ts = GST_CLOCK_TIME_NONE;
 
   dec->buf_dirty = TRUE;
+  dec->bitmap_dirty = TRUE;
   dec->use_ARGB = FALSE;
+  dec->use_overlay = FALSE;
 }
 
 static void
@@ -176,6 +192,10 @@ gst_dvd_sub_dec_finalize (GObject * gobject)
     dec->partialbuf = NULL;
   }
 
+  gst_buffer_replace (&dec->last_buf, NULL);
+  g_free (dec->runs);
+  g_free (dec->line_runs);
+
   G_OBJECT_CLASS (parent_class)->finalize (gobject);
 }
 
@@ -320,6 +340,7 @@ gst_dvd_sub_dec_parse_subpic (GstDvdSubDec * dec)
             "bottom %d", dec->left, dec->top, dec->right, dec->bottom);
 
         dec->buf_dirty = TRUE;
+        dec->bitmap_dirty = TRUE;
         buf += 7;
         break;
       case SPU_SET_OFFSETS:    /* image 1 / image 2 offsets */
@@ -331,6 +352,7 @@ gst_dvd_sub_dec_parse_subpic (GstDvdSubDec * dec)
             dec->offset[0], dec->offset[1]);
 
         dec->buf_dirty = TRUE;
+        dec->bitmap_dirty = TRUE;
         buf += 5;
         break;
       case SPU_WIPE:
@@ -345,6 +367,7 @@ gst_dvd_sub_dec_parse_subpic (GstDvdSubDec * dec)
         buf += 1 + length;
 
         dec->buf_dirty = TRUE;
+        dec->bitmap_dirty = TRUE;
         break;
       }
       case SPU_END:
@@ -388,19 +411,6 @@ gst_dvd_sub_dec_parse_subpic (GstDvdSubDec * dec)
   }
 }
 
-static inline int
-gst_get_nibble (guchar * buffer, RLE_state * state)
-{
-  if (state->aligned) {
-    state->next = buffer[state->offset[state->id]++];
-    state->aligned = 0;
-    return state->next >> 4;
-  } else {
-    state->aligned = 1;
-    return state->next & 0xf;
-  }
-}
-
 /* Premultiply the current lookup table into the "target" cache */
 static void
 gst_setup_palette (GstDvdSubDec * dec)
@@ -453,138 +463,117 @@ gst_setup_palette (GstDvdSubDec * dec)
   }
 }
 
+/* Peek at the next 16 bits of RLE data, starting at nibble @pos */
 static inline guint
-gst_get_rle_code (guchar * buffer, RLE_state * state)
+gst_peek_rle_bits (const guchar * buffer, gsize size, guint pos)
 {
-  gint code;
-
-  code = gst_get_nibble (buffer, state);
-  if (code < 0x4) {             /* 4 .. f */
-    code = (code << 4) | gst_get_nibble (buffer, state);
-    if (code < 0x10) {          /* 1x .. 3x */
-      code = (code << 4) | gst_get_nibble (buffer, state);
-      if (code < 0x40) {        /* 04x .. 0fx */
-        code = (code << 4) | gst_get_nibble (buffer, state);
-      }
+  gsize offset = pos >> 1;
+  guint32 bits;
+
+  if (G_LIKELY (offset + 3 <= size)) {
+    bits = GST_READ_UINT24_BE (buffer + offset);
+  } else {
+    gint i;
+
+    /* pad with zeroes at the end of the packet */
+    bits = 0;
+    for (i = 0; i < 3; i++) {
+      bits <<= 8;
+      if (offset + i < size)
+        bits |= buffer[offset + i];
     }
   }
-  return code;
+
+  if (pos & 1)
+    return (bits >> 4) & 0xffff;
+  else
+    return bits >> 8;
 }
 
-#define DRAW_RUN(target,len,c)                  \
-G_STMT_START {                                  \
-  gint i = 0;                                   \
-  if ((c)->A) {                                 \
-    for (i = 0; i < (len); i++) {               \
-      *(target)++ = (c)->A;                     \
-      *(target)++ = (c)->Y_R;                   \
-      *(target)++ = (c)->U_G;                   \
-      *(target)++ = (c)->V_B;                   \
-    }                                           \
-  } else {                                      \
-    (target) += 4 * (len);                      \
-  }                                             \
-} G_STMT_END
+/* Pack a palette entry as it is laid out in an AYUV/ARGB frame */
+static inline guint32
+gst_pack_colour (const Color_val * c)
+{
+  if (c->A == 0)
+    return 0;
+
+  return GUINT32_TO_BE (((guint32) c->A << 24) | (c->Y_R << 16) |
+      (c->U_G << 8) | c->V_B);
+}
+
+static void
+gst_dvd_sub_dec_pack_palettes (GstDvdSubDec * dec, guint32 * palette,
+    guint32 * hl_palette)
+{
+  gint i;
+
+  for (i = 0; i < 4; i++) {
+    if (dec->use_ARGB) {
+      palette[i] = gst_pack_colour (&dec->palette_cache_rgb[i]);
+      hl_palette[i] = gst_pack_colour (&dec->hl_palette_cache_rgb[i]);
+    } else {
+      palette[i] = gst_pack_colour (&dec->palette_cache_yuv[i]);
+      hl_palette[i] = gst_pack_colour (&dec->hl_palette_cache_yuv[i]);
+    }
+  }
+}
 
 /* 
- * This function steps over each run-length segment, drawing 
- * into the YUVA/ARGB buffers as it goes. UV are composited and then output
- * at half width/height
+ * This function steps over each run-length segment, appending a run of
+ * the palette index to the runs of the line.
  */
 static void
-gst_draw_rle_line (GstDvdSubDec * dec, guchar * buffer, RLE_state * state)
+gst_decode_rle_line (GstDvdSubDec * dec, guchar * buffer, RLE_state * state,
+    gint * n_runs)
 {
   gint length, colourid;
-  guint code;
-  gint x, right;
-  guchar *target;
-
-  target = state->target;
-
-  x = dec->left;
-  right = dec->right + 1;
+  guint bits, nibbles, code;
+  guint pos;
+  gint x, width;
+  GstDvdSubRun *run;
+
+  pos = state->pos[state->id];
+  width = dec->bitmap_width;
+
+  /* a line has at most one run per pixel */
+  if (dec->runs_size < *n_runs + width) {
+    dec->runs_size = MAX (2 * dec->runs_size, *n_runs + width);
+    dec->runs = g_renew (GstDvdSubRun, dec->runs, dec->runs_size);
+  }
+  run = dec->runs + *n_runs;
 
-  while (x < right) {
-    gboolean in_hl;
-    const Color_val *colour_entry;
+  x = 0;
+  while (x < width) {
+    bits = gst_peek_rle_bits (buffer, dec->partialmap.size, pos);
+    nibbles = rle_code_nibbles[bits >> 8];
+    code = bits >> (16 - 4 * nibbles);
+    pos += nibbles;
 
-    code = gst_get_rle_code (buffer, state);
     length = code >> 2;
     colourid = code & 3;
-    if (dec->use_ARGB)
-      colour_entry = dec->palette_cache_rgb + colourid;
-    else
-      colour_entry = dec->palette_cache_yuv + colourid;
 
     /* Length = 0 implies fill to the end of the line */
     /* Restrict the colour run to the end of the line */
-    if (length == 0 || x + length > right)
-      length = right - x;
-
-    /* Check if this run of colour touches the highlight region */
-    in_hl = ((x <= state->hl_right) && (x + length) >= state->hl_left);
-    if (in_hl) {
-      gint run;
-
-      /* Draw to the left of the highlight */
-      if (x <= state->hl_left) {
-        run = MIN (length, state->hl_left - x + 1);
-
-        DRAW_RUN (target, run, colour_entry);
-        length -= run;
-        x += run;
-      }
-
-      /* Draw across the highlight region */
-      if (x <= state->hl_right) {
-        const Color_val *hl_colour;
-        if (dec->use_ARGB)
-          hl_colour = dec->hl_palette_cache_rgb + colourid;
-        else
-          hl_colour = dec->hl_palette_cache_yuv + colourid;
-
-        run = MIN (length, state->hl_right - x + 1);
-
-        DRAW_RUN (target, run, hl_colour);
-        length -= run;
-        x += run;
-      }
-    }
-
-    /* Draw the rest of the run */
-    if (length > 0) {
-      DRAW_RUN (target, length, colour_entry);
-      x += length;
-    }
+    if (length == 0 || x + length > width)
+      length = width - x;
+
+    run->x = x;
+    run->len = length;
+    run->index = colourid;
+    run++;
+    x += length;
   }
+
+  *n_runs = run - dec->runs;
+  state->pos[state->id] = pos;
 }
 
 /*
- * Decode the RLE subtitle image and blend with the current
- * frame buffer.
+ * Fit the display rectangle into the video frame
  */
 static void
-gst_dvd_sub_dec_merge_title (GstDvdSubDec * dec, GstVideoFrame * frame)
+gst_dvd_sub_dec_clip_title (GstDvdSubDec * dec)
 {
-  gint y;
-  gint Y_stride;
-  guchar *buffer = dec->partialmap.data;
-  gint hl_top, hl_bottom;
-  gint last_y;
-  RLE_state state;
-  guint8 *Y_data;
-
-  GST_DEBUG_OBJECT (dec, "Merging subtitle on frame");
-
-  Y_data = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
-  Y_stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
-
-  state.id = 0;
-  state.aligned = 1;
-  state.next = 0;
-  state.offset[0] = dec->offset[0];
-  state.offset[1] = dec->offset[1];
-
   /* center the image when display rectangle exceeds the video width */
   if (dec->in_width <= dec->right) {
     gint left, disp_width;
@@ -628,37 +617,266 @@ gst_dvd_sub_dec_merge_title (GstDvdSubDec * dec, GstVideoFrame * frame)
     GST_DEBUG_OBJECT (dec, "clipping height to %d,%d",
         dec->top, dec->in_height - 1);
   }
+}
+
+/*
+ * Decode the RLE subtitle image into runs of palette indices, which are
+ * kept until the image or its position changes.
+ */
+static void
+gst_dvd_sub_dec_decode_bitmap (GstDvdSubDec * dec)
+{
+  guchar *buffer = dec->partialmap.data;
+  gint width, height, y, n_runs;
+  RLE_state state;
+
+  GST_DEBUG_OBJECT (dec, "Decoding subtitle bitmap");
+
+  dec->bitmap_dirty = FALSE;
+  dec->bitmap_lines = 0;
+
+  width = dec->right - dec->left + 1;
+  height = MIN (dec->bottom, dec->in_height - 1) - dec->top + 1;
+  if (width <= 0 || height <= 0 || dec->left < 0 || dec->top < 0)
+    return;
+
+  if (dec->line_runs_size < height + 1) {
+    dec->line_runs_size = height + 1;
+    dec->line_runs = g_renew (gint, dec->line_runs, dec->line_runs_size);
+  }
+  dec->bitmap_width = width;
+
+  state.id = 0;
+  state.pos[0] = 2 * dec->offset[0];
+  state.pos[1] = 2 * dec->offset[1];
+
+  /* Now decode scanlines until we hit the bottom or end of RLE data */
+  n_runs = 0;
+  for (y = 0; (((state.pos[1] + 1) >> 1) < dec->data_size + 2) && y < height;
+      y++) {
+    dec->line_runs[y] = n_runs;
+    gst_decode_rle_line (dec, buffer, &state, &n_runs);
+
+    /* Lines start on a byte boundary */
+    state.pos[state.id] = (state.pos[state.id] + 1) & ~1;
+    state.id = !state.id;
+  }
+  dec->line_runs[y] = n_runs;
+  dec->bitmap_lines = y;
+
+  GST_LOG_OBJECT (dec, "%d runs in %d lines", n_runs, y);
+}
+
+/* Fill @len pixels with a packed palette word */
+static inline void
+gst_fill_run (guint32 * target, gint len, guint32 colour, guint32 clear)
+{
+  gint i;
+
+  if (colour == 0)
+    colour = clear;
+
+  for (i = 0; i < len; i++)
+    target[i] = colour;
+}
+
+/*
+ * Colour the bitmap pixels inside the given rectangle of the video frame
+ * into @data, where pixel (x0,y0) of the frame is.
+ */
+static void
+gst_dvd_sub_dec_colourise (GstDvdSubDec * dec, guint8 * data, gint stride,
+    gint x0, gint y0, gint left, gint top, gint right, gint bottom,
+    const guint32 * palette, const guint32 * hl_palette, guint32 clear)
+{
+  gint y, i;
+
+  left = MAX (left, dec->left);
+  top = MAX (top, dec->top);
+  right = MIN (right, dec->left + dec->bitmap_width - 1);
+  bottom = MIN (bottom, dec->top + dec->bitmap_lines - 1);
+
+  GST_LOG_OBJECT (dec, "Colourising (%d,%d) to (%d,%d)", left, top, right,
+      bottom);
+
+  for (y = top; y <= bottom; y++) {
+    guint32 *target = (guint32 *) (data + (y - y0) * stride);
+    gint hl_left = G_MAXINT, hl_right = G_MININT;
+    gint last = dec->line_runs[y - dec->top + 1];
+
+    /* Draw the highlight region with its own palette */
+    if (dec->current_button && y >= dec->hl_top && y <= dec->hl_bottom) {
+      hl_left = dec->hl_left;
+      hl_right = dec->hl_right;
+    }
+
+    for (i = dec->line_runs[y - dec->top]; i < last; i++) {
+      const GstDvdSubRun *run = &dec->runs[i];
+      gint start = dec->left + run->x;
+      gint end = start + run->len - 1;
+
+      if (end < left)
+        continue;
+      if (start > right)
+        break;
+      start = MAX (start, left);
+      end = MIN (end, right);
+
+      /* split the run where it enters and leaves the highlight */
+      if (start < hl_left) {
+        gint split = MIN (end, hl_left - 1);
+
+        gst_fill_run (target + start - x0, split - start + 1,
+            palette[run->index], clear);
+        start = split + 1;
+      }
+      if (start <= end && start <= hl_right) {
+        gint split = MIN (end, hl_right);
+
+        gst_fill_run (target + start - x0, split - start + 1,
+            hl_palette[run->index], clear);
+        start = split + 1;
+      }
+      if (start <= end)
+        gst_fill_run (target + start - x0, end - start + 1,
+            palette[run->index], clear);
+    }
+  }
+}
+
+/*
+ * Render only the display rectangle and hand it out as an overlay
+ * rectangle attached to an empty buffer.
+ */
+static GstBuffer *
+gst_dvd_sub_dec_render_overlay (GstDvdSubDec * dec, const guint32 * palette,
+    const guint32 * hl_palette)
+{
+  GstVideoOverlayComposition *comp;
+  GstVideoOverlayRectangle *rect;
+  GstBuffer *out_buf, *pixels;
+  GstMapInfo map;
+  gint width, height;
+
+  out_buf = gst_buffer_new ();
+
+  width = dec->bitmap_width;
+  height = dec->bitmap_lines;
+  if (!(dec->visible || dec->forced_display) || width <= 0 || height <= 0)
+    return out_buf;
+
+  pixels = gst_buffer_new_allocate (NULL, width * height * 4, NULL);
+  gst_buffer_map (pixels, &map, GST_MAP_WRITE);
+  gst_dvd_sub_dec_colourise (dec, map.data, width * 4, dec->left, dec->top,
+      dec->left, dec->top, dec->left + width - 1, dec->top + height - 1,
+      palette, hl_palette, 0);
+  gst_buffer_unmap (pixels, &map);
+
+  gst_buffer_add_video_meta (pixels, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_OVERLAY_COMPOSITION_FORMAT_YUV, width, height);
+  rect = gst_video_overlay_rectangle_new_raw (pixels, dec->left, dec->top,
+      width, height, GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+  gst_buffer_unref (pixels);
+
+  comp = gst_video_overlay_composition_new (rect);
+  gst_video_overlay_rectangle_unref (rect);
+  gst_buffer_add_video_overlay_composition_meta (out_buf, comp);
+  gst_video_overlay_composition_unref (comp);
+
+  return out_buf;
+}
+
+/*
+ * Re-use the last full frame when only the highlight moved since it was
+ * rendered, and return the area that needs colouring again.
+ */
+static GstBuffer *
+gst_dvd_sub_dec_reuse_frame (GstDvdSubDec * dec, const guint32 * palette,
+    gint * damage)
+{
+  GstBuffer *out_buf;
+  gint hl[4] = { -1, -1, -2, -2 };
+  gint i;
+
+  if (dec->last_buf == NULL)
+    return NULL;
+
+  /* the highlight palette only matters inside the old and new highlight */
+  if (memcmp (dec->last_palette, palette, sizeof (dec->last_palette)) != 0 ||
+      dec->last_rect[0] != dec->left || dec->last_rect[1] != dec->top ||
+      dec->last_rect[2] != dec->right || dec->last_rect[3] != dec->bottom)
+    return NULL;
 
   if (dec->current_button) {
-    hl_top = dec->hl_top;
-    hl_bottom = dec->hl_bottom;
+    hl[0] = dec->hl_left;
+    hl[1] = dec->hl_top;
+    hl[2] = dec->hl_right;
+    hl[3] = dec->hl_bottom;
+  }
+
+  /* the old and the new highlight both need colouring */
+  if (dec->last_hl[2] < dec->last_hl[0]) {
+    memcpy (damage, hl, sizeof (hl));
+  } else if (hl[2] < hl[0]) {
+    memcpy (damage, dec->last_hl, sizeof (hl));
   } else {
-    hl_top = -1;
-    hl_bottom = -1;
+    for (i = 0; i < 2; i++) {
+      damage[i] = MIN (hl[i], dec->last_hl[i]);
+      damage[i + 2] = MAX (hl[i + 2], dec->last_hl[i + 2]);
+    }
   }
-  last_y = MIN (dec->bottom, dec->in_height);
 
-  y = dec->top;
-  state.target = Y_data + 4 * dec->left + (y * Y_stride);
+  /* Copies the frame only if downstream still holds on to it */
+  out_buf = gst_buffer_make_writable (dec->last_buf);
+  dec->last_buf = NULL;
 
-  /* Now draw scanlines until we hit last_y or end of RLE data */
-  for (; ((state.offset[1] < dec->data_size + 2) && (y <= last_y)); y++) {
-    /* Set up to draw the highlight if we're in the right scanlines */
-    if (y > hl_bottom || y < hl_top) {
-      state.hl_left = -1;
-      state.hl_right = -1;
-    } else {
-      state.hl_left = dec->hl_left;
-      state.hl_right = dec->hl_right;
-    }
-    gst_draw_rle_line (dec, buffer, &state);
+  return out_buf;
+}
+
+/* Check if rendering now would give the same output as the last time */
+static gboolean
+gst_dvd_sub_dec_frame_unchanged (GstDvdSubDec * dec, const guint32 * palette,
+    const guint32 * hl_palette)
+{
+  if (dec->last_buf == NULL)
+    return FALSE;
 
-    state.target += Y_stride;
+  if (memcmp (dec->last_palette, palette, sizeof (dec->last_palette)) != 0 ||
+      dec->last_rect[0] != dec->left || dec->last_rect[1] != dec->top ||
+      dec->last_rect[2] != dec->right || dec->last_rect[3] != dec->bottom)
+    return FALSE;
 
-    /* Realign the RLE state for the next line */
-    if (!state.aligned)
-      gst_get_nibble (buffer, &state);
-    state.id = !state.id;
+  if (!dec->current_button)
+    return dec->last_hl[2] < dec->last_hl[0];
+
+  return dec->last_hl[0] == dec->hl_left && dec->last_hl[1] == dec->hl_top &&
+      dec->last_hl[2] == dec->hl_right && dec->last_hl[3] == dec->hl_bottom &&
+      memcmp (dec->last_hl_palette, hl_palette,
+      sizeof (dec->last_hl_palette)) == 0;
+}
+
+static void
+gst_dvd_sub_dec_store_frame (GstDvdSubDec * dec, GstBuffer * buf,
+    const guint32 * palette, const guint32 * hl_palette)
+{
+  gst_buffer_replace (&dec->last_buf, buf);
+  if (buf == NULL)
+    return;
+
+  memcpy (dec->last_palette, palette, sizeof (dec->last_palette));
+  memcpy (dec->last_hl_palette, hl_palette, sizeof (dec->last_hl_palette));
+  dec->last_rect[0] = dec->left;
+  dec->last_rect[1] = dec->top;
+  dec->last_rect[2] = dec->right;
+  dec->last_rect[3] = dec->bottom;
+  if (dec->current_button) {
+    dec->last_hl[0] = dec->hl_left;
+    dec->last_hl[1] = dec->hl_top;
+    dec->last_hl[2] = dec->hl_right;
+    dec->last_hl[3] = dec->hl_bottom;
+  } else {
+    dec->last_hl[0] = dec->last_hl[1] = -1;
+    dec->last_hl[2] = dec->last_hl[3] = -2;
   }
 }
 
@@ -683,6 +901,8 @@ gst_send_subtitle_frame (GstDvdSubDec * dec, GstClockTime end_ts)
   GstVideoFrame frame;
   guint8 *data;
   gint x, y;
+  guint32 palette[4], hl_palette[4], clear;
+  gint damage[4];
   static GstAllocationParams params = { 0, 3, 0, 0, };
 
   g_assert (dec->have_title);
@@ -694,6 +914,46 @@ gst_send_subtitle_frame (GstDvdSubDec * dec, GstClockTime end_ts)
     goto out;
   }
 
+  gst_dvd_sub_dec_clip_title (dec);
+
+  if (dec->bitmap_dirty) {
+    gst_dvd_sub_dec_decode_bitmap (dec);
+    gst_dvd_sub_dec_store_frame (dec, NULL, NULL, NULL);
+  }
+
+  gst_dvd_sub_dec_pack_palettes (dec, palette, hl_palette);
+
+  /* Nothing visible changed, send the last frame again with new timestamps */
+  if (gst_dvd_sub_dec_frame_unchanged (dec, palette, hl_palette)) {
+    GST_DEBUG_OBJECT (dec, "Subtitle unchanged, not rendering");
+    out_buf = gst_buffer_copy (dec->last_buf);
+    goto done;
+  }
+
+  GST_DEBUG_OBJECT (dec, "Rendering subtitle frame");
+
+  if (dec->use_overlay) {
+    out_buf = gst_dvd_sub_dec_render_overlay (dec, palette, hl_palette);
+    goto store;
+  }
+
+  if (dec->use_ARGB)
+    clear = 0;
+  else
+    clear = GUINT32_TO_BE (0x00108080);
+
+  out_buf = gst_dvd_sub_dec_reuse_frame (dec, palette, damage);
+  if (out_buf) {
+    GST_DEBUG_OBJECT (dec, "Only updating the highlight");
+
+    gst_video_frame_map (&frame, &dec->info, out_buf, GST_MAP_READWRITE);
+    gst_dvd_sub_dec_colourise (dec, GST_VIDEO_FRAME_PLANE_DATA (&frame, 0),
+        GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0), 0, 0, damage[0], damage[1],
+        damage[2], damage[3], palette, hl_palette, clear);
+    gst_video_frame_unmap (&frame);
+    goto store;
+  }
+
   out_buf =
       gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&dec->info), &params);
   gst_video_frame_map (&frame, &dec->info, out_buf, GST_MAP_READWRITE);
@@ -701,34 +961,27 @@ gst_send_subtitle_frame (GstDvdSubDec * dec, GstClockTime end_ts)
   data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
 
   /* Clear the buffer */
-  /* FIXME - move this into the buffer rendering code */
   for (y = 0; y < dec->in_height; y++) {
-    guchar *line = data + 4 * dec->in_width * y;
-
-    for (x = 0; x < dec->in_width; x++) {
-      line[0] = 0;              /* A */
-      if (!dec->use_ARGB) {
-        line[1] = 16;           /* Y */
-        line[2] = 128;          /* U */
-        line[3] = 128;          /* V */
-      } else {
-        line[1] = 0;            /* R */
-        line[2] = 0;            /* G */
-        line[3] = 0;            /* B */
-      }
+    guint32 *line = (guint32 *) (data + 4 * dec->in_width * y);
 
-      line += 4;
-    }
+    for (x = 0; x < dec->in_width; x++)
+      line[x] = clear;
   }
 
   /* FIXME: do we really want to honour the forced_display flag
    * for subtitles streans? */
   if (dec->visible || dec->forced_display) {
-    gst_dvd_sub_dec_merge_title (dec, &frame);
+    gst_dvd_sub_dec_colourise (dec, data,
+        GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0), 0, 0, dec->left, dec->top,
+        dec->right, dec->bottom, palette, hl_palette, clear);
   }
 
   gst_video_frame_unmap (&frame);
 
+store:
+  gst_dvd_sub_dec_store_frame (dec, out_buf, palette, hl_palette);
+
+done:
   dec->buf_dirty = FALSE;
 
   GST_BUFFER_TIMESTAMP (out_buf) = dec->next_ts;
@@ -855,6 +1108,7 @@ gst_dvd_sub_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       dec->visible = FALSE;
 
       dec->have_title = TRUE;
+      dec->bitmap_dirty = TRUE;
       dec->next_event_ts = GST_BUFFER_TIMESTAMP (dec->partialbuf);
 
       if (!GST_CLOCK_TIME_IS_VALID (dec->next_event_ts))
@@ -867,6 +1121,35 @@ gst_dvd_sub_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return ret;
 }
 
+/* Only go for overlay composition meta when downstream explicitly
+ * supports it, not just because it accepts any caps */
+static gboolean
+gst_dvd_sub_dec_peer_wants_overlay (GstDvdSubDec * dec)
+{
+  GstCaps *caps;
+  gboolean ret = FALSE;
+  guint i;
+
+  caps = gst_pad_peer_query_caps (dec->srcpad, NULL);
+  if (caps == NULL)
+    return FALSE;
+
+  if (!gst_caps_is_any (caps)) {
+    for (i = 0; i < gst_caps_get_size (caps); i++) {
+      GstCapsFeatures *features = gst_caps_get_features (caps, i);
+
+      if (features && gst_caps_features_contains (features,
+              GST_CAPS_FEATURE_META_GST_VIDEO_OVERLAY_COMPOSITION)) {
+        ret = TRUE;
+        break;
+      }
+    }
+  }
+  gst_caps_unref (caps);
+
+  return ret;
+}
+
 static gboolean
 gst_dvd_sub_dec_sink_setcaps (GstPad * pad, GstCaps * caps)
 {
@@ -882,7 +1165,18 @@ gst_dvd_sub_dec_sink_setcaps (GstPad * pad, GstCaps * caps)
       "height", G_TYPE_INT, dec->in_height,
       "framerate", GST_TYPE_FRACTION, 0, 1, NULL);
 
-  peer_caps = gst_pad_get_allowed_caps (dec->srcpad);
+  dec->use_overlay = gst_dvd_sub_dec_peer_wants_overlay (dec);
+  if (dec->use_overlay) {
+    GST_DEBUG_OBJECT (dec, "peer takes overlay composition meta");
+    dec->use_ARGB = FALSE;
+    gst_caps_set_features (out_caps, 0,
+        gst_caps_features_new
+        (GST_CAPS_FEATURE_META_GST_VIDEO_OVERLAY_COMPOSITION, NULL));
+    peer_caps = NULL;
+  } else {
+    peer_caps = gst_pad_get_allowed_caps (dec->srcpad);
+  }
+
   if (G_LIKELY (peer_caps)) {
     guint i = 0, n = 0;
 
@@ -921,6 +1215,7 @@ gst_dvd_sub_dec_sink_setcaps (GstPad * pad, GstCaps * caps)
       out_caps);
   if (gst_pad_set_caps (dec->srcpad, out_caps)) {
     gst_video_info_from_caps (&dec->info, out_caps);
+    gst_buffer_replace (&dec->last_buf, NULL);
   } else {
     GST_WARNING_OBJECT (dec, "failed setting downstream caps");
     gst_caps_unref (out_caps);
@@ -44,6 +44,14 @@ typedef struct Color_val
 
 } Color_val;
 
+/* Run of pixels of one palette index in a line of the subpicture */
+typedef struct _GstDvdSubRun
+{
+  guint16 x;                    /* from the left edge of the subpicture */
+  guint16 len;
+  guint8 index;
+} GstDvdSubRun;
+
 struct _GstDvdSubDec
 {
   GstElement element;
@@ -72,6 +80,8 @@ struct _GstDvdSubDec
 
   GstVideoInfo info;
   gboolean use_ARGB;
+  /* only output the display rectangle as overlay composition meta */
+  gboolean use_overlay;
   GstClockTime next_ts;
 
   /*
@@ -96,6 +106,26 @@ struct _GstDvdSubDec
   GstClockTime next_event_ts;
 
   gboolean buf_dirty;
+
+  /* the decoded subpicture, bitmap_lines lines of bitmap_width pixels
+   * starting at (left,top), as runs of palette indices. The runs of line y
+   * are runs[line_runs[y]] up to runs[line_runs[y + 1]]. */
+  GstDvdSubRun *runs;
+  gint runs_size;
+  gint *line_runs;
+  gint line_runs_size;
+  gint bitmap_width;
+  gint bitmap_lines;
+  gboolean bitmap_dirty;
+
+  /* last frame rendered and the state it was rendered with, so that
+   * unchanged frames are not rendered again and highlight changes only need
+   * to colour the highlight again */
+  GstBuffer *last_buf;
+  guint32 last_palette[4];
+  guint32 last_hl_palette[4];
+  gint last_rect[4];
+  gint last_hl[4];
 };
 
 struct _GstDvdSubDecClass
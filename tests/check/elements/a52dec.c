@@ -0,0 +1,649 @@
+/*
+ * GStreamer
+ *
+ * unit test for a52dec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudiodecoder.h>
+
+#include <a52dec/a52.h>
+#include "gsta52interleave.h"
+
+#define SRC_CAPS "audio/x-ac3; audio/x-private1-ac3"
+#define SINK_CAPS "audio/x-raw; audio/x-ac3, framed = (boolean) true"
+#define AC3_SINK_CAPS "audio/x-ac3, framed = (boolean) true"
+
+/* 32 kbit/s at 48 kHz */
+#define AC3_FRAME_SIZE 128
+
+static GstPad *srcpad, *sinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS)
+    );
+
+/* like a sink on a S/PDIF only device */
+static GstStaticPadTemplate ac3_sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (AC3_SINK_CAPS)
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SRC_CAPS)
+    );
+
+static GstElement *
+setup_a52dec_full (const gchar * src_caps, GstStaticPadTemplate * sink_tmpl)
+{
+  GstElement *a52dec;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_a52dec");
+
+  a52dec = gst_check_setup_element ("a52dec");
+  srcpad = gst_check_setup_src_pad (a52dec, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (a52dec, sink_tmpl);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (a52dec,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (src_caps);
+  gst_check_setup_events (srcpad, a52dec, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return a52dec;
+}
+
+static GstElement *
+setup_a52dec (const gchar * src_caps)
+{
+  return setup_a52dec_full (src_caps, &sinktemplate);
+}
+
+static void
+cleanup_a52dec (GstElement * a52dec)
+{
+  GST_DEBUG ("cleanup_a52dec");
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (a52dec);
+  gst_check_teardown_sink_pad (a52dec);
+  gst_check_teardown_element (a52dec);
+}
+
+static guint
+put_bits (guint8 * data, guint pos, guint32 value, guint n_bits)
+{
+  while (n_bits--) {
+    if ((value >> n_bits) & 1)
+      data[pos / 8] |= 0x80 >> (pos % 8);
+    pos++;
+  }
+
+  return pos;
+}
+
+/* a frame of silence at 48 kHz, 32 kbit/s, bsid 8, stereo. The first audio
+ * block sends exponents and all zero SNR offsets, so no mantissa takes any
+ * bits; the other five reuse all of that and are nothing but zero bits. */
+static void
+fill_ac3_frame (guint8 * data)
+{
+  guint pos, ch, grp;
+
+  memset (data, 0, AC3_FRAME_SIZE);
+  data[0] = 0x0b;
+  data[1] = 0x77;
+  data[5] = 0x40;
+  data[6] = 0x40;
+
+  /* the rest of the bit stream information is all zero flags */
+  pos = 67;
+  /* blksw, dithflag, dynrnge */
+  pos = put_bits (data, pos, 0, 5);
+  /* cplstre, no coupling; rematstr, no rematrixing in any of the 4 bands */
+  pos = put_bits (data, pos, 2, 2);
+  pos = put_bits (data, pos, 1, 1);
+  pos = put_bits (data, pos, 0, 4);
+  /* D15 exponents up to chbwcod 0, that is 73 mantissas */
+  for (ch = 0; ch < 2; ch++)
+    pos = put_bits (data, pos, 1, 2);
+  for (ch = 0; ch < 2; ch++)
+    pos = put_bits (data, pos, 0, 6);
+  for (ch = 0; ch < 2; ch++) {
+    pos = put_bits (data, pos, 15, 4);
+    /* 24 groups of three deltas of 0 */
+    for (grp = 0; grp < 24; grp++)
+      pos = put_bits (data, pos, 62, 7);
+    /* gainrng */
+    pos = put_bits (data, pos, 0, 2);
+  }
+  /* baie: sdcycod 2, fdcycod 1, sgaincod 1, dbpbcod 2, floorcod 7 */
+  pos = put_bits (data, pos, 1, 1);
+  pos = put_bits (data, pos, 0x4b7, 11);
+  /* snroffste: csnroffst 0, then fsnroffst 0 and fgaincod 4 per channel */
+  pos = put_bits (data, pos, 1, 1);
+  pos = put_bits (data, pos, 0, 6);
+  for (ch = 0; ch < 2; ch++)
+    pos = put_bits (data, pos, 4, 7);
+  /* deltbaie, skiple */
+  pos = put_bits (data, pos, 0, 2);
+
+  /* leaves the last byte for the tests to mark frames with */
+  g_assert (pos + 5 * 15 < (AC3_FRAME_SIZE - 1) * 8);
+}
+
+static GstBuffer *
+create_ac3_frame (void)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_buffer_new_and_alloc (AC3_FRAME_SIZE);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  fill_ac3_frame (map.data);
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+/* a run of frames after @garbage_size bytes of junk; the last byte of each
+ * frame carries @first_marker, @first_marker + 1, ... to tell them apart.
+ * With @fake_sync_offset >= 0 the junk has a valid looking frame header
+ * there, without a frame following it. */
+static GstBuffer *
+create_ac3_stream (guint garbage_size, gint fake_sync_offset, guint n_frames,
+    guint8 first_marker)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint8 *data;
+  guint i;
+
+  buffer = gst_buffer_new_and_alloc (garbage_size + n_frames * AC3_FRAME_SIZE);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  memset (map.data, 0xff, garbage_size);
+  if (fake_sync_offset >= 0) {
+    fail_unless ((guint) fake_sync_offset + 7 <= garbage_size);
+    memcpy (map.data + fake_sync_offset, "\x0b\x77\x00\x00\x00\x40\x40", 7);
+  }
+  data = map.data + garbage_size;
+  for (i = 0; i < n_frames; i++, data += AC3_FRAME_SIZE) {
+    fill_ac3_frame (data);
+    data[AC3_FRAME_SIZE - 1] = first_marker + i;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+/* passthrough hands out exactly the parsed frames */
+static void
+check_frame_markers (guint8 first_marker, guint n_frames)
+{
+  GstMapInfo map;
+  guint i;
+
+  fail_unless_equals_int (g_list_length (buffers), n_frames);
+
+  for (i = 0; i < n_frames; i++) {
+    GstBuffer *buffer = g_list_nth_data (buffers, i);
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, AC3_FRAME_SIZE);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data), 0x0b77);
+    fail_unless_equals_int (map.data[AC3_FRAME_SIZE - 1], first_marker + i);
+    gst_buffer_unmap (buffer, &map);
+  }
+}
+
+/* DVD packets start with a first_access header pointing (1-based) at the
+ * first frame starting in the packet, which the timestamp applies to */
+static GstBuffer *
+create_dvd_packet (guint first_access, guint tail_size, guint n_frames,
+    GstClockTime timestamp)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint8 *data;
+  guint i;
+
+  buffer =
+      gst_buffer_new_and_alloc (2 + tail_size + n_frames * AC3_FRAME_SIZE);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  GST_WRITE_UINT16_BE (map.data, first_access);
+  data = map.data + 2;
+  /* fake tail of the previous frame, continuing a split one */
+  memset (data, 0, tail_size);
+  data += tail_size;
+  for (i = 0; i < n_frames; i++, data += AC3_FRAME_SIZE)
+    fill_ac3_frame (data);
+  gst_buffer_unmap (buffer, &map);
+  GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+
+  return buffer;
+}
+
+static void
+check_ac3_caps (void)
+{
+  GstStructure *s;
+  GstCaps *caps;
+  gboolean framed;
+  gint rate, channels;
+
+  caps = gst_pad_get_current_caps (sinkpad);
+  fail_unless (caps != NULL);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_has_name (s, "audio/x-ac3"));
+  fail_unless (gst_structure_get_boolean (s, "framed", &framed));
+  fail_unless (framed);
+  fail_unless (gst_structure_get_int (s, "rate", &rate));
+  fail_unless_equals_int (rate, 48000);
+  fail_unless (gst_structure_get_int (s, "channels", &channels));
+  fail_unless_equals_int (channels, 2);
+  gst_caps_unref (caps);
+}
+
+GST_START_TEST (test_passthrough)
+{
+  GstElement *a52dec;
+  GstMapInfo map;
+  gint i;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buffer = create_ac3_frame ();
+
+    GST_BUFFER_TIMESTAMP (buffer) = i * 32 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  check_ac3_caps ();
+
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buffer = g_list_nth_data (buffers, i);
+
+    /* one buffer per 1536 sample frame, passed on untouched for the sink
+     * to wrap into IEC 61937 bursts */
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer),
+        32 * GST_MSECOND);
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, AC3_FRAME_SIZE);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data), 0x0b77);
+    fail_unless_equals_int (map.data[5], 0x40);
+    fail_unless_equals_int (map.data[6], 0x40);
+    gst_buffer_unmap (buffer, &map);
+  }
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_passthrough_downstream)
+{
+  GstElement *a52dec;
+
+  /* no passthrough property, but downstream can't take decoded audio */
+  a52dec = setup_a52dec_full ("audio/x-ac3", &ac3_sinktemplate);
+
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (0, -1, 2, 1)), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  check_frame_markers (1, 2);
+  check_ac3_caps ();
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_dvd_first_access)
+{
+  GstElement *a52dec;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gint i;
+
+  a52dec = setup_a52dec ("audio/x-private1-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  /* frames 0 and 1, and the first half of frame 2 */
+  buffer = create_dvd_packet (1, 0, 3, 0);
+  gst_buffer_set_size (buffer, 2 + 2 * AC3_FRAME_SIZE + AC3_FRAME_SIZE / 2);
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+
+  /* the rest of frame 2, then frames 3 and 4 */
+  buffer = create_dvd_packet (AC3_FRAME_SIZE / 2 + 1, AC3_FRAME_SIZE / 2, 2,
+      3 * 32 * GST_MSECOND);
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), 5);
+
+  for (i = 0; i < 5; i++) {
+    buffer = g_list_nth_data (buffers, i);
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer),
+        i * 32 * GST_MSECOND);
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, AC3_FRAME_SIZE);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data), 0x0b77);
+    gst_buffer_unmap (buffer, &map);
+  }
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_leading_garbage)
+{
+  GstElement *a52dec;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (50, -1, 3, 1)), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  check_frame_markers (1, 3);
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_false_sync)
+{
+  GstElement *a52dec;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  /* the fake header says the next frame starts 128 bytes on, in the middle
+   * of the first real frame, so it must not be taken */
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (40, 0, 3, 1)), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  check_frame_markers (1, 3);
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_resync)
+{
+  GstElement *a52dec;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  /* in sync on the first two frames */
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (0, -1, 2, 1)), GST_FLOW_OK);
+  /* then junk with a false sync word in it, and two more frames; the first
+   * of them is only accepted because the second one follows it */
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (30, 5, 1, 3)), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (0, -1, 1, 4)), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  check_frame_markers (1, 4);
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_sync_at_eos)
+{
+  GstElement *a52dec;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "passthrough", TRUE, NULL);
+
+  /* a lone frame can't be confirmed by the next one, until EOS says there
+   * won't be any */
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_ac3_stream (10, -1, 1, 1)), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  check_frame_markers (1, 1);
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+static void
+push_ac3_frames (guint first, guint n_frames)
+{
+  guint i;
+
+  for (i = 0; i < n_frames; i++) {
+    GstBuffer *buffer = create_ac3_frame ();
+
+    GST_BUFFER_TIMESTAMP (buffer) = (first + i) * 32 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  }
+}
+
+static void
+check_latency (GstElement * a52dec, GstClockTime expected)
+{
+  GstClockTime min, max;
+
+  gst_audio_decoder_get_latency (GST_AUDIO_DECODER (a52dec), &min, &max);
+  fail_unless_equals_uint64 (min, expected);
+  fail_unless_equals_uint64 (max, expected);
+}
+
+/* decoded output buffers hold @batches[i] frames of 1536 samples each */
+static void
+check_batches (const guint * batches, guint n_batches)
+{
+  GstAudioInfo info;
+  GstCaps *caps;
+  guint i, frames = 0;
+
+  fail_unless_equals_int (g_list_length (buffers), n_batches);
+
+  caps = gst_pad_get_current_caps (sinkpad);
+  fail_unless (caps != NULL);
+  fail_unless (gst_audio_info_from_caps (&info, caps));
+  gst_caps_unref (caps);
+
+  for (i = 0; i < n_batches; i++) {
+    GstBuffer *buffer = g_list_nth_data (buffers, i);
+
+    fail_unless_equals_int (gst_buffer_get_size (buffer),
+        batches[i] * 1536 * GST_AUDIO_INFO_BPF (&info));
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer),
+        frames * 32 * GST_MSECOND);
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer),
+        batches[i] * 32 * GST_MSECOND);
+    frames += batches[i];
+  }
+}
+
+GST_START_TEST (test_output_frames)
+{
+  const guint batches[] = { 4, 4, 2 };
+  GstElement *a52dec;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "output-frames", 4, NULL);
+
+  push_ac3_frames (0, 10);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  /* the first frame of a batch waits for three more */
+  check_latency (a52dec, 96 * GST_MSECOND);
+
+  /* draining pushes out the incomplete batch */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  check_batches (batches, G_N_ELEMENTS (batches));
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_output_frames_flush)
+{
+  const guint batches[] = { 4, 1 };
+  GstElement *a52dec;
+  GstSegment segment;
+
+  a52dec = setup_a52dec ("audio/x-ac3");
+  g_object_set (a52dec, "output-frames", 4, NULL);
+
+  push_ac3_frames (0, 3);
+  fail_unless_equals_int (g_list_length (buffers), 0);
+
+  /* a flush drops the frames collected so far */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  push_ac3_frames (0, 4);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  check_latency (a52dec, 96 * GST_MSECOND);
+
+  /* a new batch size applies from the next batch on, along with its
+   * latency */
+  g_object_set (a52dec, "output-frames", 1, NULL);
+  push_ac3_frames (4, 1);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  check_latency (a52dec, 0);
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  check_batches (batches, G_N_ELEMENTS (batches));
+
+  cleanup_a52dec (a52dec);
+}
+
+GST_END_TEST;
+
+/* the interleave as it was before it got specialised per channel count */
+static void
+reference_interleave (sample_t * dest, const sample_t * src, gint chans,
+    const gint * reorder_map)
+{
+  gint n, c;
+
+  for (n = 0; n < 256; n++) {
+    for (c = 0; c < chans; c++)
+      dest[n * chans + reorder_map[c]] = src[c * 256 + n];
+  }
+}
+
+GST_START_TEST (test_interleave_bitexact)
+{
+  sample_t src[6 * 256], expected[6 * 256], out[6 * 256];
+  gint reorder_map[6];
+  GRand *rand;
+  gint chans, i, j, iter;
+
+  rand = g_rand_new_with_seed (0xa52);
+
+  for (i = 0; i < 6 * 256; i++)
+    src[i] = g_rand_double_range (rand, -1.0, 1.0);
+
+  for (chans = 1; chans <= 6; chans++) {
+    for (iter = 0; iter < 16; iter++) {
+      /* identity first, then random channel permutations */
+      for (i = 0; i < chans; i++)
+        reorder_map[i] = i;
+      if (iter > 0) {
+        for (i = chans - 1; i > 0; i--) {
+          gint tmp;
+
+          j = g_rand_int_range (rand, 0, i + 1);
+          tmp = reorder_map[i];
+          reorder_map[i] = reorder_map[j];
+          reorder_map[j] = tmp;
+        }
+      }
+
+      /* same poison in both so that missed samples show up as well */
+      memset (expected, 0x5a, sizeof (expected));
+      memset (out, 0x5a, sizeof (out));
+
+      reference_interleave (expected, src, chans, reorder_map);
+      gst_a52dec_interleave (out, src, chans, reorder_map);
+
+      fail_unless (memcmp (out, expected, sizeof (out)) == 0,
+          "interleave differs for %d channels, iteration %d", chans, iter);
+    }
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static Suite *
+a52dec_suite (void)
+{
+  Suite *s = suite_create ("a52dec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_passthrough);
+  tcase_add_test (tc_chain, test_passthrough_downstream);
+  tcase_add_test (tc_chain, test_dvd_first_access);
+  tcase_add_test (tc_chain, test_parse_leading_garbage);
+  tcase_add_test (tc_chain, test_parse_false_sync);
+  tcase_add_test (tc_chain, test_parse_resync);
+  tcase_add_test (tc_chain, test_parse_sync_at_eos);
+  tcase_add_test (tc_chain, test_output_frames);
+  tcase_add_test (tc_chain, test_output_frames_flush);
+  tcase_add_test (tc_chain, test_interleave_bitexact);
+  return s;
+}
+
+GST_CHECK_MAIN (a52dec);
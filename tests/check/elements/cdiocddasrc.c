@@ -0,0 +1,312 @@
+/*
+ * GStreamer
+ *
+ * unit test for the cdiocddasrc sample helpers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "gstcdiosamples.h"
+
+/* bytes in a raw audio sector */
+#define SECTOR_SIZE 2352
+
+GST_START_TEST (test_swap_samples)
+{
+  /* a read of 16 sectors, a single one, and odd sample counts */
+  const gsize sizes[] = { 16 * SECTOR_SIZE, SECTOR_SIZE, SECTOR_SIZE + 2, 6,
+    2, 0
+  };
+  guint16 *samples, *expected;
+  GRand *rand;
+  gsize i, j, n;
+
+  rand = g_rand_new_with_seed (71);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    n = sizes[i] / 2;
+
+    /* one more sample that must stay untouched */
+    samples = g_new (guint16, n + 1);
+    expected = g_new (guint16, n + 1);
+    for (j = 0; j <= n; j++)
+      samples[j] = g_rand_int (rand);
+
+    for (j = 0; j < n; j++)
+      expected[j] = GUINT16_SWAP_LE_BE (samples[j]);
+    expected[n] = samples[n];
+
+    gst_cdio_cdda_src_swap_samples ((guint8 *) samples, sizes[i]);
+
+    for (j = 0; j <= n; j++) {
+      fail_unless (samples[j] == expected[j],
+          "sample %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes is 0x%04x, "
+          "expected 0x%04x", j, sizes[i], samples[j], expected[j]);
+    }
+
+    g_free (samples);
+    g_free (expected);
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+/* the detection as it used to run on open, over @n_sectors sectors */
+static GstCdioEndianness
+reference_detect (const gint16 * pcm_data, gint n_sectors, gdouble * ne_factor,
+    gdouble * oe_factor)
+{
+  gint16 last_pcm_ne = 0, last_pcm_oe = 0;
+  gdouble ne_sumd0 = 0.0, ne_sumd1 = 0.0;
+  gdouble oe_sumd0 = 0.0, oe_sumd1 = 0.0;
+  gdouble diff;
+  gint i;
+
+  /* only evaluate samples for left channel */
+  for (i = 0; i < n_sectors * GST_CDIO_SAMPLES_PER_SECTOR; i += 2) {
+    gint16 pcm;
+
+    pcm = pcm_data[i];
+    ne_sumd0 += abs (pcm);
+    ne_sumd1 += abs (pcm - last_pcm_ne);
+    last_pcm_ne = pcm;
+
+    pcm = GUINT16_SWAP_LE_BE (pcm);
+    oe_sumd0 += abs (pcm);
+    oe_sumd1 += abs (pcm - last_pcm_oe);
+    last_pcm_oe = pcm;
+  }
+
+  *ne_factor = ne_sumd1 / ne_sumd0;
+  *oe_factor = oe_sumd1 / oe_sumd0;
+  diff = *ne_factor - *oe_factor;
+
+  if (diff > 0.5)
+    return GST_CDIO_ENDIANNESS_OTHER;
+  else if (diff < -0.5)
+    return GST_CDIO_ENDIANNESS_NATIVE;
+  return GST_CDIO_ENDIANNESS_INCONCLUSIVE;
+}
+
+/* stereo sine of @freq Hz at @amplitude, plus noise of up to @noise, in host
+ * endianness */
+static gint16 *
+create_pcm (gint n_sectors, gdouble freq, gint amplitude, gint noise,
+    GRand * rand)
+{
+  gint n = n_sectors * GST_CDIO_SAMPLES_PER_SECTOR;
+  gint16 *pcm = g_new (gint16, n);
+  gint i;
+
+  for (i = 0; i < n; i += 2) {
+    gdouble v = amplitude * sin (2 * G_PI * freq * (i / 2) / 44100.0);
+
+    if (noise > 0)
+      v += g_rand_int_range (rand, -noise, noise + 1);
+    v = CLAMP (v, G_MININT16, G_MAXINT16);
+    pcm[i] = (gint16) v;
+    pcm[i + 1] = (gint16) - v;
+  }
+
+  return pcm;
+}
+
+static void
+check_detect (const gint16 * pcm, gint n_silent, gint chunk)
+{
+  GstCdioEndiannessDetect detect;
+  GstCdioEndianness expected;
+  gdouble ne_factor, oe_factor;
+  guint8 *data;
+  gint n, i;
+
+  expected = reference_detect (pcm, GST_CDIO_DETECT_SECTORS, &ne_factor,
+      &oe_factor);
+
+  /* silent sectors first, then the ones with audio */
+  n = n_silent + GST_CDIO_DETECT_SECTORS;
+  data = g_new0 (guint8, n * SECTOR_SIZE);
+  memcpy (data + n_silent * SECTOR_SIZE, pcm,
+      GST_CDIO_DETECT_SECTORS * SECTOR_SIZE);
+
+  gst_cdio_endianness_detect_init (&detect);
+  for (i = 0; i < n; i += chunk) {
+    gint count = MIN (chunk, n - i);
+
+    fail_unless_equals_int (gst_cdio_endianness_detect_add (&detect,
+            data + i * SECTOR_SIZE, count), i + count > n_silent);
+    if (i + count < n)
+      fail_unless_equals_int (detect.result, GST_CDIO_ENDIANNESS_UNKNOWN);
+  }
+
+  if (expected == GST_CDIO_ENDIANNESS_INCONCLUSIVE) {
+    /* another attempt on the next sectors */
+    fail_unless_equals_int (detect.result, GST_CDIO_ENDIANNESS_UNKNOWN);
+    fail_unless_equals_int (detect.attempts, 1);
+  } else {
+    fail_unless_equals_int (detect.result, expected);
+  }
+  fail_unless_equals_float (detect.ne_factor, ne_factor);
+  fail_unless_equals_float (detect.oe_factor, oe_factor);
+
+  g_free (data);
+}
+
+GST_START_TEST (test_detect_endianness)
+{
+  const gdouble freqs[] = { 50.0, 440.0, 1000.0, 5000.0, 15000.0 };
+  const gint amplitudes[] = { 30000, 8000, 1000, 100, 10 };
+  const gint noises[] = { 0, 10, 300 };
+  gint n_decided = 0;
+  GRand *rand;
+  guint f, a, n;
+
+  rand = g_rand_new_with_seed (74);
+
+  for (f = 0; f < G_N_ELEMENTS (freqs); f++) {
+    for (a = 0; a < G_N_ELEMENTS (amplitudes); a++) {
+      for (n = 0; n < G_N_ELEMENTS (noises); n++) {
+        GstCdioEndianness native;
+        gdouble ne_factor, oe_factor;
+        gint16 *pcm;
+
+        pcm = create_pcm (GST_CDIO_DETECT_SECTORS, freqs[f], amplitudes[a],
+            noises[n], rand);
+
+        /* in one go, sector by sector and in reads of 3 sectors after some
+         * silence */
+        check_detect (pcm, 0, GST_CDIO_DETECT_SECTORS);
+        check_detect (pcm, 0, 1);
+        check_detect (pcm, 4, 3);
+
+        native = reference_detect (pcm, GST_CDIO_DETECT_SECTORS, &ne_factor,
+            &oe_factor);
+
+        /* and the same from a drive of the other endianness */
+        gst_cdio_cdda_src_swap_samples ((guint8 *) pcm,
+            GST_CDIO_DETECT_SECTORS * SECTOR_SIZE);
+        check_detect (pcm, 0, GST_CDIO_DETECT_SECTORS);
+        check_detect (pcm, 4, 3);
+
+        if (native == GST_CDIO_ENDIANNESS_NATIVE) {
+          fail_unless_equals_int (reference_detect (pcm,
+                  GST_CDIO_DETECT_SECTORS, &ne_factor, &oe_factor),
+              GST_CDIO_ENDIANNESS_OTHER);
+          n_decided++;
+        }
+
+        g_free (pcm);
+      }
+    }
+  }
+
+  /* loud enough music is always recognised */
+  fail_unless (n_decided >= G_N_ELEMENTS (freqs) * G_N_ELEMENTS (noises) * 2);
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_detect_endianness_silence)
+{
+  GstCdioEndiannessDetect detect;
+  guint8 *data;
+
+  data = g_new0 (guint8, 2 * GST_CDIO_DETECT_SECTORS * SECTOR_SIZE);
+
+  gst_cdio_endianness_detect_init (&detect);
+  fail_if (gst_cdio_endianness_detect_add (&detect, data,
+          2 * GST_CDIO_DETECT_SECTORS));
+  fail_unless_equals_int (detect.result, GST_CDIO_ENDIANNESS_UNKNOWN);
+  fail_unless_equals_int (detect.sectors, 0);
+
+  /* a single non-zero sample is not silence */
+  data[SECTOR_SIZE - 1] = 1;
+  fail_unless (gst_cdio_endianness_detect_add (&detect, data, 1));
+  fail_unless_equals_int (detect.sectors, 1);
+
+  g_free (data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_detect_endianness_noise)
+{
+  GstCdioEndiannessDetect detect;
+  gdouble ne_factor, oe_factor;
+  gint16 *pcm;
+  GRand *rand;
+  gint i, n;
+
+  rand = g_rand_new_with_seed (74);
+
+  /* noise looks the same in both byte orders */
+  n = GST_CDIO_DETECT_ATTEMPTS * GST_CDIO_DETECT_SECTORS *
+      GST_CDIO_SAMPLES_PER_SECTOR;
+  pcm = g_new (gint16, n);
+  for (i = 0; i < n; i++)
+    pcm[i] = g_rand_int (rand);
+
+  gst_cdio_endianness_detect_init (&detect);
+  for (i = 0; i < GST_CDIO_DETECT_ATTEMPTS; i++) {
+    const gint16 *sectors = pcm + i * GST_CDIO_DETECT_SECTORS *
+        GST_CDIO_SAMPLES_PER_SECTOR;
+
+    fail_unless_equals_int (reference_detect (sectors,
+            GST_CDIO_DETECT_SECTORS, &ne_factor, &oe_factor),
+        GST_CDIO_ENDIANNESS_INCONCLUSIVE);
+    fail_unless_equals_int (detect.result, GST_CDIO_ENDIANNESS_UNKNOWN);
+    gst_cdio_endianness_detect_add (&detect, (const guint8 *) sectors,
+        GST_CDIO_DETECT_SECTORS);
+    fail_unless_equals_float (detect.ne_factor, ne_factor);
+    fail_unless_equals_float (detect.oe_factor, oe_factor);
+  }
+  fail_unless_equals_int (detect.result, GST_CDIO_ENDIANNESS_INCONCLUSIVE);
+
+  /* and nothing is added after a result */
+  fail_unless (gst_cdio_endianness_detect_add (&detect, (const guint8 *) pcm,
+          1));
+  fail_unless_equals_int (detect.sectors, 0);
+
+  g_free (pcm);
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static Suite *
+cdiocddasrc_suite (void)
+{
+  Suite *s = suite_create ("cdiocddasrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_swap_samples);
+  tcase_add_test (tc_chain, test_detect_endianness);
+  tcase_add_test (tc_chain, test_detect_endianness_silence);
+  tcase_add_test (tc_chain, test_detect_endianness_noise);
+  return s;
+}
+
+GST_CHECK_MAIN (cdiocddasrc);
@@ -0,0 +1,290 @@
+/*
+ * GStreamer
+ *
+ * unit test for dvdlpcmdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/audio/audio.h>
+
+#define SRC_CAPS "audio/x-private-ts-lpcm; audio/x-private1-lpcm"
+#define SINK_CAPS "audio/x-raw"
+
+#define N_FRAMES 8
+
+static GstPad *srcpad, *sinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS)
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SRC_CAPS)
+    );
+
+/* Blu-ray channel layouts and where each of their channels ends up in
+ * GStreamer order */
+static const struct
+{
+  guint8 indicator;
+  gint channels;
+  gint reorder_map[8];
+} layouts[] = {
+  /* stereo */
+  {0x3, 2, {0, 1}},
+  /* 5.1: FL FR FC SL SR LFE */
+  {0x9, 6, {0, 1, 2, 4, 5, 3}},
+  /* 7.1: FL FR FC SL SR RL RR LFE */
+  {0xb, 8, {0, 1, 2, 6, 7, 4, 5, 3}},
+};
+
+static GstElement *
+setup_dvdlpcmdec (const gchar * src_caps)
+{
+  GstElement *dvdlpcmdec;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_dvdlpcmdec");
+
+  dvdlpcmdec = gst_check_setup_element ("dvdlpcmdec");
+  srcpad = gst_check_setup_src_pad (dvdlpcmdec, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (dvdlpcmdec, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (dvdlpcmdec,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (src_caps);
+  gst_check_setup_events (srcpad, dvdlpcmdec, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return dvdlpcmdec;
+}
+
+static void
+cleanup_dvdlpcmdec (GstElement * dvdlpcmdec)
+{
+  GST_DEBUG ("cleanup_dvdlpcmdec");
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (dvdlpcmdec);
+  gst_check_teardown_sink_pad (dvdlpcmdec);
+  gst_check_teardown_element (dvdlpcmdec);
+}
+
+/* straightforward unpacking of sample @k, one at a time */
+static void
+unpack_sample (const guint8 * src, gint width, guint k, guint8 * dest)
+{
+  guint group_size = width == 24 ? 12 : 10;
+  const guint8 *group = src + (k / 4) * group_size;
+  guint j = k % 4;
+
+  if (width == 16) {
+    dest[0] = src[2 * k];
+    dest[1] = src[2 * k + 1];
+    return;
+  }
+
+  dest[0] = group[2 * j];
+  dest[1] = group[2 * j + 1];
+  if (width == 24) {
+    dest[2] = group[8 + j];
+  } else if (j % 2 == 0) {
+    dest[2] = group[8 + j / 2] & 0xf0;
+  } else {
+    dest[2] = (group[8 + j / 2] & 0x0f) << 4;
+  }
+}
+
+static void
+check_unpack (gint width, guint layout)
+{
+  GstElement *dvdlpcmdec;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  GstBuffer *inbuf;
+  gint channels = layouts[layout].channels;
+  guint n_samples = N_FRAMES * channels;
+  gint bps = width == 16 ? 2 : 3;
+  gsize payload_size;
+  guint8 *payload;
+  guint32 header;
+  guint i;
+
+  if (width == 16)
+    payload_size = n_samples * 2;
+  else
+    payload_size = n_samples / 4 * (width == 24 ? 12 : 10);
+
+  GST_DEBUG ("width %d, %d channels", width, channels);
+
+  dvdlpcmdec = setup_dvdlpcmdec ("audio/x-private-ts-lpcm");
+
+  buffer = gst_buffer_new_and_alloc (4 + payload_size);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  /* 48 kHz, and sample depth code 1, 2 or 3 for 16, 20 or 24 bits */
+  header = payload_size << 16 | layouts[layout].indicator << 12 | 0x1 << 8 |
+      (width - 12) / 4 << 6;
+  GST_WRITE_UINT32_BE (map.data, header);
+  payload = map.data + 4;
+  for (i = 0; i < payload_size; i++)
+    payload[i] = (i * 37 + 11) & 0xff;
+  payload = g_malloc (payload_size);
+  memcpy (payload, map.data + 4, payload_size);
+  gst_buffer_unmap (buffer, &map);
+
+  inbuf = gst_buffer_ref (buffer);
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  buffer = buffers->data;
+  fail_unless_equals_int (gst_buffer_get_size (buffer), n_samples * bps);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+
+  /* 16-bit samples in GStreamer order are passed on without copying */
+  if (width == 16 && channels == 2) {
+    GstMapInfo inmap;
+
+    gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
+    fail_unless (map.data == inmap.data + 4);
+    gst_buffer_unmap (inbuf, &inmap);
+  }
+
+  for (i = 0; i < n_samples; i++) {
+    guint frame = i / channels;
+    guint c = layouts[layout].reorder_map[i % channels];
+    guint8 expected[3];
+
+    unpack_sample (payload, width, i, expected);
+    fail_unless (memcmp (map.data + (frame * channels + c) * bps, expected,
+            bps) == 0, "sample %u differs", i);
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  gst_buffer_unref (inbuf);
+  g_free (payload);
+  cleanup_dvdlpcmdec (dvdlpcmdec);
+}
+
+GST_START_TEST (test_reorder_16bit)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (layouts); i++)
+    check_unpack (16, i);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_unpack_20bit)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (layouts); i++)
+    check_unpack (20, i);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_unpack_24bit)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (layouts); i++)
+    check_unpack (24, i);
+}
+
+GST_END_TEST;
+
+/* A DVD packet: first_access, the 3 byte header, the tail of the previous
+ * frame and then a new one */
+GST_START_TEST (test_dvd_split)
+{
+  GstElement *dvdlpcmdec;
+  GstBuffer *buffer, *inbuf;
+  GstMapInfo map, inmap;
+  const guint tail_size = 8, frame_size = 16;
+  guint i;
+
+  dvdlpcmdec = setup_dvdlpcmdec ("audio/x-private1-lpcm");
+
+  inbuf = gst_buffer_new_and_alloc (2 + 3 + tail_size + frame_size);
+  gst_buffer_map (inbuf, &inmap, GST_MAP_WRITE);
+  GST_WRITE_UINT16_BE (inmap.data, 3 + tail_size + 1);
+  /* 16 bits, 48 kHz, stereo */
+  inmap.data[2] = 0x00;
+  inmap.data[3] = 0x01;
+  inmap.data[4] = 0x80;
+  for (i = 5; i < inmap.size; i++)
+    inmap.data[i] = i;
+  gst_buffer_unmap (inbuf, &inmap);
+
+  fail_unless_equals_int (gst_pad_push (srcpad, gst_buffer_ref (inbuf)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
+
+  buffer = buffers->data;
+  fail_unless_equals_int (gst_buffer_get_size (buffer), tail_size);
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless (memcmp (map.data, inmap.data + 5, tail_size) == 0);
+  gst_buffer_unmap (buffer, &map);
+
+  /* the new frame is passed on in the packet's own memory */
+  buffer = buffers->next->data;
+  fail_unless_equals_int (gst_buffer_get_size (buffer), frame_size);
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless (map.data == inmap.data + 5 + tail_size);
+  gst_buffer_unmap (buffer, &map);
+
+  gst_buffer_unmap (inbuf, &inmap);
+  gst_buffer_unref (inbuf);
+
+  cleanup_dvdlpcmdec (dvdlpcmdec);
+}
+
+GST_END_TEST;
+
+static Suite *
+dvdlpcmdec_suite (void)
+{
+  Suite *s = suite_create ("dvdlpcmdec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_reorder_16bit);
+  tcase_add_test (tc_chain, test_unpack_20bit);
+  tcase_add_test (tc_chain, test_unpack_24bit);
+  tcase_add_test (tc_chain, test_dvd_split);
+  return s;
+}
+
+GST_CHECK_MAIN (dvdlpcmdec);
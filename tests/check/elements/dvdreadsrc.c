@@ -0,0 +1,197 @@
+/*
+ * GStreamer
+ *
+ * unit test for the dvdreadsrc time map index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "dvdreadindex.h"
+
+/* about 2h45 of a title with a time map entry every second */
+#define N_ENTRIES 10000
+#define TMU 1
+
+/* sector of entry @j, with entries roughly 100 sectors apart */
+static guint32
+entry_sector (guint j)
+{
+  return 1000 + j * 100 + (j * 37) % 7;
+}
+
+/* the last entry at or before @ts, by walking the whole map */
+static gint
+reference_sector_from_time (const guint32 * map, guint n, GstClockTime ts)
+{
+  guint j;
+  gint sector = -1;
+
+  for (j = 0; j < n; j++) {
+    GstClockTime t = (guint64) TMU * (j + 1) * GST_SECOND;
+
+    if (t <= ts || j == 0)
+      sector = map[j] & 0x7fffffff;
+    if (t >= ts)
+      break;
+  }
+  if (j == n && ts != 0)
+    return -1;
+
+  return sector;
+}
+
+static void
+check_index (const guint32 * map, gboolean expect_sorted)
+{
+  GstDvdReadIndexEntry *by_time, *by_sector;
+  GRand *rand;
+  guint j;
+
+  fail_unless_equals_int (gst_dvd_read_index_build (map, N_ENTRIES, TMU,
+          &by_time, &by_sector), expect_sorted);
+
+  for (j = 0; j < N_ENTRIES; j++) {
+    GstClockTime t = (guint64) TMU * (j + 1) * GST_SECOND;
+    guint32 sector = map[j] & 0x7fffffff;
+
+    fail_unless_equals_int (gst_dvd_read_index_get_sector_from_time (by_time,
+            N_ENTRIES, t), sector);
+    fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector
+        (by_sector, N_ENTRIES, sector), t);
+    /* half way to the next entry still seeks to this one */
+    if (j + 1 < N_ENTRIES) {
+      fail_unless_equals_int (gst_dvd_read_index_get_sector_from_time (by_time,
+              N_ENTRIES, t + GST_SECOND / 2), sector);
+    }
+  }
+
+  /* before the first and after the last entry */
+  fail_unless_equals_int (gst_dvd_read_index_get_sector_from_time (by_time,
+          N_ENTRIES, GST_SECOND / 2), map[0] & 0x7fffffff);
+  fail_unless_equals_int (gst_dvd_read_index_get_sector_from_time (by_time,
+          N_ENTRIES, (guint64) (N_ENTRIES + 1) * TMU * GST_SECOND), -1);
+  fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector (by_sector,
+          N_ENTRIES, 0), 0);
+
+  rand = g_rand_new_with_seed (70);
+  for (j = 0; j < 1000; j++) {
+    GstClockTime ts = g_rand_int_range (rand, 0, N_ENTRIES * TMU + 1);
+
+    ts = ts * GST_SECOND + g_rand_int_range (rand, 0, GST_SECOND);
+    fail_unless_equals_int (gst_dvd_read_index_get_sector_from_time (by_time,
+            N_ENTRIES, ts), reference_sector_from_time (map, N_ENTRIES, ts));
+  }
+  g_rand_free (rand);
+
+  g_free (by_time);
+  g_free (by_sector);
+}
+
+GST_START_TEST (test_index_sorted)
+{
+  guint32 *map;
+  GstDvdReadIndexEntry *by_time, *by_sector;
+  guint32 s0, s1;
+  guint j;
+
+  map = g_new (guint32, N_ENTRIES);
+  for (j = 0; j < N_ENTRIES; j++)
+    map[j] = entry_sector (j);
+
+  check_index (map, TRUE);
+
+  /* sectors between two entries are interpolated */
+  gst_dvd_read_index_build (map, N_ENTRIES, TMU, &by_time, &by_sector);
+  s0 = entry_sector (41);
+  s1 = entry_sector (42);
+  fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector (by_sector,
+          N_ENTRIES, s0 + (s1 - s0) / 2),
+      42 * GST_SECOND + gst_util_uint64_scale (GST_SECOND, (s1 - s0) / 2,
+          s1 - s0));
+  /* but not before the first entry */
+  fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector (by_sector,
+          N_ENTRIES, entry_sector (0) - 1), GST_CLOCK_TIME_NONE);
+  g_free (by_time);
+  g_free (by_sector);
+
+  g_free (map);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_index_unsorted)
+{
+  guint32 *map;
+  guint j;
+
+  /* the second half of the title is stored on disc before the first one */
+  map = g_new (guint32, N_ENTRIES);
+  for (j = 0; j < N_ENTRIES / 2; j++)
+    map[j] = entry_sector (N_ENTRIES / 2 + j);
+  for (; j < N_ENTRIES; j++)
+    map[j] = entry_sector (j - N_ENTRIES / 2);
+
+  check_index (map, FALSE);
+
+  g_free (map);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_index_discont)
+{
+  GstDvdReadIndexEntry *by_time, *by_sector;
+  guint32 *map;
+  guint j;
+
+  map = g_new (guint32, N_ENTRIES);
+  for (j = 0; j < N_ENTRIES; j++)
+    map[j] = entry_sector (j);
+  map[100] |= 0x80000000;
+
+  gst_dvd_read_index_build (map, N_ENTRIES, TMU, &by_time, &by_sector);
+
+  /* no interpolating into a discontinuity */
+  fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector (by_sector,
+          N_ENTRIES, entry_sector (100) - 1), GST_CLOCK_TIME_NONE);
+  fail_unless_equals_uint64 (gst_dvd_read_index_get_time_for_sector (by_sector,
+          N_ENTRIES, entry_sector (100)), 101 * GST_SECOND);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (gst_dvd_read_index_get_time_for_sector
+          (by_sector, N_ENTRIES, entry_sector (100) + 1)));
+
+  g_free (by_time);
+  g_free (by_sector);
+  g_free (map);
+}
+
+GST_END_TEST;
+
+static Suite *
+dvdreadsrc_suite (void)
+{
+  Suite *s = suite_create ("dvdreadsrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_index_sorted);
+  tcase_add_test (tc_chain, test_index_unsorted);
+  tcase_add_test (tc_chain, test_index_discont);
+  return s;
+}
+
+GST_CHECK_MAIN (dvdreadsrc);
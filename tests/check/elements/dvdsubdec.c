@@ -0,0 +1,582 @@
+/*
+ * GStreamer
+ *
+ * unit test for dvdsubdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#define SRC_CAPS "subpicture/x-dvd"
+#define SINK_CAPS "video/x-raw, format = (string) ARGB"
+#define OVERLAY_SINK_CAPS "video/x-raw(" \
+    GST_CAPS_FEATURE_META_GST_VIDEO_OVERLAY_COMPOSITION "), " \
+    "format = (string) AYUV"
+
+#define FRAME_WIDTH 720
+
+#define SPU_LEFT 100
+#define SPU_TOP 200
+#define SPU_WIDTH 200
+#define SPU_HEIGHT 6
+
+static GstPad *srcpad, *sinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS)
+    );
+
+/* like a video sink or compositor blending the subpicture itself */
+static GstStaticPadTemplate overlay_sinktemplate =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (OVERLAY_SINK_CAPS)
+    );
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SRC_CAPS)
+    );
+
+/* the first entries of the element's default colour lookup table, which
+ * are all grey */
+static const guint8 default_luma[4] = { 0xb4, 0x24, 0x62, 0xd7 };
+
+/* run lengths covering all code sizes, the rest of each line is filled */
+static const guint run_lengths[] = { 1, 3, 5, 17, 70 };
+
+static GstElement *
+setup_dvdsubdec_full (GstStaticPadTemplate * sink_tmpl)
+{
+  GstElement *dvdsubdec;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_dvdsubdec");
+
+  dvdsubdec = gst_check_setup_element ("dvdsubdec");
+  srcpad = gst_check_setup_src_pad (dvdsubdec, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (dvdsubdec, sink_tmpl);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (dvdsubdec,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (SRC_CAPS);
+  gst_check_setup_events (srcpad, dvdsubdec, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return dvdsubdec;
+}
+
+static GstElement *
+setup_dvdsubdec (void)
+{
+  return setup_dvdsubdec_full (&sinktemplate);
+}
+
+static void
+cleanup_dvdsubdec (GstElement * dvdsubdec)
+{
+  GST_DEBUG ("cleanup_dvdsubdec");
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (dvdsubdec);
+  gst_check_teardown_sink_pad (dvdsubdec);
+  gst_check_teardown_element (dvdsubdec);
+}
+
+/* colour index of pixel @x on line @y of the subpicture */
+static guint
+expected_index (guint x, guint y)
+{
+  guint i, end = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (run_lengths); i++) {
+    end += run_lengths[i];
+    if (x < end)
+      return (i + y) % 4;
+  }
+
+  return (i + y) % 4;
+}
+
+static void
+put_nibbles (guint8 * data, guint * pos, guint code, guint n)
+{
+  while (n--) {
+    guint nibble = (code >> (4 * n)) & 0xf;
+
+    if (*pos & 1)
+      data[*pos >> 1] |= nibble;
+    else
+      data[*pos >> 1] = nibble << 4;
+    (*pos)++;
+  }
+}
+
+static void
+put_run (guint8 * data, guint * pos, guint length, guint colour)
+{
+  guint n;
+
+  if (length == 0)
+    n = 4;
+  else if (length < 4)
+    n = 1;
+  else if (length < 16)
+    n = 2;
+  else if (length < 64)
+    n = 3;
+  else
+    n = 4;
+
+  put_nibbles (data, pos, length << 2 | colour, n);
+}
+
+/* Encode lines @field, @field + 2, ... of the subpicture at nibble @pos */
+static void
+put_field (guint8 * data, guint * pos, guint field)
+{
+  guint y, i;
+
+  for (y = field; y < SPU_HEIGHT; y += 2) {
+    for (i = 0; i < G_N_ELEMENTS (run_lengths); i++)
+      put_run (data, pos, run_lengths[i], (i + y) % 4);
+    /* fill till the end of the line */
+    put_run (data, pos, 0, (i + y) % 4);
+
+    /* lines start on a byte boundary */
+    if (*pos & 1)
+      put_nibbles (data, pos, 0, 1);
+  }
+}
+
+/* A subpicture shown right away. With @repeat_ticks, a second control
+ * sequence sets the same palette again after that delay. */
+static GstBuffer *
+create_spu (GstClockTime timestamp, guint repeat_ticks)
+{
+  GstBuffer *buffer;
+  guint8 data[1024];
+  guint pos, offset[2], dcsq;
+  const guint left = SPU_LEFT, right = SPU_LEFT + SPU_WIDTH - 1;
+  const guint top = SPU_TOP, bottom = SPU_TOP + SPU_HEIGHT - 1;
+  guint8 *p;
+
+  pos = 2 * 4;
+  offset[0] = pos / 2;
+  put_field (data, &pos, 0);
+  offset[1] = pos / 2;
+  put_field (data, &pos, 1);
+  dcsq = pos / 2;
+
+  p = data + dcsq;
+  /* no delay */
+  GST_WRITE_UINT16_BE (p, 0);
+  p += 4;
+  /* colour i is entry i of the lookup table, fully opaque */
+  *p++ = 0x03;
+  *p++ = 0x32;
+  *p++ = 0x10;
+  *p++ = 0x04;
+  *p++ = 0xff;
+  *p++ = 0xff;
+  *p++ = 0x05;
+  *p++ = left >> 4;
+  *p++ = (left & 0xf) << 4 | right >> 8;
+  *p++ = right & 0xff;
+  *p++ = top >> 4;
+  *p++ = (top & 0xf) << 4 | bottom >> 8;
+  *p++ = bottom & 0xff;
+  *p++ = 0x06;
+  GST_WRITE_UINT16_BE (p, offset[0]);
+  GST_WRITE_UINT16_BE (p + 2, offset[1]);
+  p += 4;
+  *p++ = 0x01;
+  *p++ = 0xff;
+
+  if (repeat_ticks) {
+    GST_WRITE_UINT16_BE (data + dcsq + 2, p - data);
+    GST_WRITE_UINT16_BE (p, repeat_ticks);
+    /* the last control sequence points to itself */
+    GST_WRITE_UINT16_BE (p + 2, p - data);
+    p += 4;
+    *p++ = 0x03;
+    *p++ = 0x32;
+    *p++ = 0x10;
+    *p++ = 0xff;
+  } else {
+    GST_WRITE_UINT16_BE (data + dcsq + 2, dcsq);
+  }
+
+  GST_WRITE_UINT16_BE (data, p - data);
+  GST_WRITE_UINT16_BE (data + 2, dcsq);
+
+  buffer = gst_buffer_new_and_alloc (p - data);
+  gst_buffer_fill (buffer, 0, data, p - data);
+  GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+
+  return buffer;
+}
+
+/* Check a frame against the encoded subpicture, with the lookup table entries
+ * of colours reversed inside @hl */
+static void
+check_frame (GstBuffer * buffer, const GstVideoRectangle * hl)
+{
+  GstMapInfo map;
+  guint x, y;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, FRAME_WIDTH * 576 * 4);
+
+  /* the line above is left transparent */
+  for (x = 0; x < FRAME_WIDTH; x++)
+    fail_unless_equals_int (map.data[((SPU_TOP - 1) * FRAME_WIDTH + x) * 4],
+        0);
+
+  for (y = 0; y < SPU_HEIGHT; y++) {
+    const guint8 *line = map.data + (SPU_TOP + y) * FRAME_WIDTH * 4;
+
+    fail_unless_equals_int (line[(SPU_LEFT - 1) * 4], 0);
+    fail_unless_equals_int (line[(SPU_LEFT + SPU_WIDTH) * 4], 0);
+
+    for (x = 0; x < SPU_WIDTH; x++) {
+      const guint8 *pixel = line + (SPU_LEFT + x) * 4;
+      guint index = expected_index (x, y);
+      guint luma, grey;
+
+      if (hl && SPU_LEFT + x >= hl->x && SPU_LEFT + x < hl->x + hl->w &&
+          SPU_TOP + y >= hl->y && SPU_TOP + y < hl->y + hl->h)
+        index = 3 - index;
+
+      luma = default_luma[index];
+      /* grey stays grey when converted to RGB */
+      grey = CLAMP ((298 * (luma - 16) + 128) >> 8, 0, 255);
+
+      fail_unless (pixel[0] == 0xff && pixel[1] == grey && pixel[2] == grey
+          && pixel[3] == grey, "pixel %u,%u differs", x, y);
+    }
+  }
+  gst_buffer_unmap (buffer, &map);
+}
+
+GST_START_TEST (test_decode_rle)
+{
+  GstElement *dvdsubdec;
+  GstBuffer *buffer;
+
+  dvdsubdec = setup_dvdsubdec ();
+
+  fail_unless_equals_int (gst_pad_push (srcpad, create_spu (0, 0)),
+      GST_FLOW_OK);
+  /* move time on so the subpicture gets shown */
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (GST_SECOND, 0)));
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = buffers->data;
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), 0);
+  check_frame (buffer, NULL);
+
+  cleanup_dvdsubdec (dvdsubdec);
+}
+
+GST_END_TEST;
+
+static GstEvent *
+create_highlight_event (const GstVideoRectangle * hl)
+{
+  GstStructure *s;
+
+  /* colour i of the highlight is entry 3 - i of the lookup table */
+  s = gst_structure_new ("application/x-gst-dvd",
+      "event", G_TYPE_STRING, "dvd-spu-highlight",
+      "button", G_TYPE_INT, 1,
+      "palette", G_TYPE_INT, 0x0123ffff,
+      "sx", G_TYPE_INT, hl->x,
+      "sy", G_TYPE_INT, hl->y,
+      "ex", G_TYPE_INT, hl->x + hl->w - 1,
+      "ey", G_TYPE_INT, hl->y + hl->h - 1, NULL);
+
+  return gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM, s);
+}
+
+GST_START_TEST (test_highlight)
+{
+  GstElement *dvdsubdec;
+  GstVideoRectangle hl[2] = {
+    {SPU_LEFT + 10, SPU_TOP + 1, 40, 3},
+    {SPU_LEFT + 90, SPU_TOP, 60, 2},
+  };
+  guint i;
+
+  dvdsubdec = setup_dvdsubdec ();
+
+  fail_unless_equals_int (gst_pad_push (srcpad, create_spu (0, 0)),
+      GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (GST_SECOND, 0)));
+
+  /* move the highlight around, each frame recolours the old and the new
+   * highlight of the previous one */
+  for (i = 0; i < G_N_ELEMENTS (hl); i++) {
+    fail_unless (gst_pad_push_event (srcpad, create_highlight_event (&hl[i])));
+    fail_unless (gst_pad_push_event (srcpad,
+            gst_event_new_gap ((i + 2) * GST_SECOND, 0)));
+  }
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  check_frame (g_list_nth_data (buffers, 0), NULL);
+  for (i = 0; i < G_N_ELEMENTS (hl); i++) {
+    GstBuffer *buffer = g_list_nth_data (buffers, i + 1);
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer),
+        (i + 1) * GST_SECOND);
+    check_frame (buffer, &hl[i]);
+  }
+
+  cleanup_dvdsubdec (dvdsubdec);
+}
+
+GST_END_TEST;
+
+/* Control sequences that change nothing visible don't render again */
+GST_START_TEST (test_unchanged_frame)
+{
+  GstElement *dvdsubdec;
+  GstBuffer *buffer;
+  GstMapInfo map[2];
+  GstClockTime repeat_ts;
+  guint i;
+
+  dvdsubdec = setup_dvdsubdec ();
+
+  repeat_ts = gst_util_uint64_scale (44, 1024 * GST_SECOND, 90000);
+
+  fail_unless_equals_int (gst_pad_push (srcpad, create_spu (0, 44)),
+      GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (GST_SECOND, 0)));
+
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  buffer = buffers->data;
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), 0);
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer), repeat_ts);
+  buffer = buffers->next->data;
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), repeat_ts);
+  check_frame (buffer, NULL);
+
+  /* the second frame is the first one again */
+  for (i = 0; i < 2; i++)
+    gst_buffer_map (g_list_nth_data (buffers, i), &map[i], GST_MAP_READ);
+  fail_unless (map[0].data == map[1].data);
+  for (i = 0; i < 2; i++)
+    gst_buffer_unmap (g_list_nth_data (buffers, i), &map[i]);
+
+  cleanup_dvdsubdec (dvdsubdec);
+}
+
+GST_END_TEST;
+
+static GstEvent *
+create_clut_event (const guint32 * clut)
+{
+  GstStructure *s;
+  gchar name[16];
+  guint i;
+
+  s = gst_structure_new_empty ("application/x-gst-dvd");
+  gst_structure_set (s, "event", G_TYPE_STRING, "dvd-spu-clut-change", NULL);
+  for (i = 0; i < 16; i++) {
+    g_snprintf (name, sizeof (name), "clut%02u", i);
+    gst_structure_set (s, name, G_TYPE_INT, (gint) clut[i], NULL);
+  }
+
+  return gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM, s);
+}
+
+/* Frames that were rendered have memory of their own, while the ones sent
+ * again share it with the frame before */
+static guint
+count_rendered_frames (void)
+{
+  GList *l;
+  const guint8 *last = NULL;
+  guint count = 0;
+
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    if (map.data != last)
+      count++;
+    last = map.data;
+    gst_buffer_unmap (l->data, &map);
+  }
+
+  return count;
+}
+
+/* Only changes that show render again */
+GST_START_TEST (test_render_count)
+{
+  GstElement *dvdsubdec;
+  GstVideoRectangle hl = { SPU_LEFT + 10, SPU_TOP + 1, 40, 3 };
+  guint32 clut[16];
+  guint i;
+
+  dvdsubdec = setup_dvdsubdec ();
+
+  /* the second control sequence changes nothing */
+  fail_unless_equals_int (gst_pad_push (srcpad, create_spu (0, 44)),
+      GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (GST_SECOND, 0)));
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  fail_unless_equals_int (count_rendered_frames (), 1);
+
+  /* a new highlight renders, the same highlight again doesn't */
+  for (i = 0; i < 2; i++) {
+    fail_unless (gst_pad_push_event (srcpad, create_highlight_event (&hl)));
+    fail_unless (gst_pad_push_event (srcpad,
+            gst_event_new_gap ((i + 2) * GST_SECOND, 0)));
+  }
+  fail_unless_equals_int (g_list_length (buffers), 4);
+  fail_unless_equals_int (count_rendered_frames (), 2);
+  check_frame (g_list_nth_data (buffers, 3), &hl);
+
+  /* changing lookup table entries the subpicture doesn't use renders
+   * nothing, changing one of the ones it uses does */
+  for (i = 0; i < 4; i++)
+    clut[i] = default_luma[i] << 16 | 0x8080;
+  for (; i < 16; i++)
+    clut[i] = 0x108080;
+  fail_unless (gst_pad_push_event (srcpad, create_clut_event (clut)));
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (4 * GST_SECOND, 0)));
+  fail_unless_equals_int (g_list_length (buffers), 5);
+  fail_unless_equals_int (count_rendered_frames (), 2);
+
+  clut[0] = 0x108080;
+  fail_unless (gst_pad_push_event (srcpad, create_clut_event (clut)));
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (5 * GST_SECOND, 0)));
+  fail_unless_equals_int (g_list_length (buffers), 6);
+  fail_unless_equals_int (count_rendered_frames (), 3);
+
+  cleanup_dvdsubdec (dvdsubdec);
+}
+
+GST_END_TEST;
+
+/* Downstream blending the subpicture itself only gets the display
+ * rectangle, as AYUV in an overlay composition on an empty buffer */
+GST_START_TEST (test_overlay_composition)
+{
+  GstElement *dvdsubdec;
+  GstBuffer *buffer, *pixels;
+  GstVideoOverlayCompositionMeta *meta;
+  GstVideoOverlayRectangle *rect;
+  GstVideoMeta *vmeta;
+  GstMapInfo map;
+  gint x, y;
+  guint w, h;
+
+  dvdsubdec = setup_dvdsubdec_full (&overlay_sinktemplate);
+
+  fail_unless_equals_int (gst_pad_push (srcpad, create_spu (0, 0)),
+      GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_gap (GST_SECOND, 0)));
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = buffers->data;
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), 0);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), 0);
+
+  meta = gst_buffer_get_video_overlay_composition_meta (buffer);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (gst_video_overlay_composition_n_rectangles
+      (meta->overlay), 1);
+  rect = gst_video_overlay_composition_get_rectangle (meta->overlay, 0);
+
+  fail_unless (gst_video_overlay_rectangle_get_render_rectangle (rect, &x, &y,
+          &w, &h));
+  fail_unless_equals_int (x, SPU_LEFT);
+  fail_unless_equals_int (y, SPU_TOP);
+  fail_unless_equals_int (w, SPU_WIDTH);
+  fail_unless_equals_int (h, SPU_HEIGHT);
+
+  pixels = gst_video_overlay_rectangle_get_pixels_raw (rect,
+      GST_VIDEO_OVERLAY_FORMAT_FLAG_NONE);
+  vmeta = gst_buffer_get_video_meta (pixels);
+  fail_unless (vmeta != NULL);
+  fail_unless_equals_int (vmeta->format,
+      GST_VIDEO_OVERLAY_COMPOSITION_FORMAT_YUV);
+  fail_unless_equals_int (vmeta->width, SPU_WIDTH);
+  fail_unless_equals_int (vmeta->height, SPU_HEIGHT);
+
+  gst_buffer_map (pixels, &map, GST_MAP_READ);
+  for (y = 0; y < SPU_HEIGHT; y++) {
+    const guint8 *line = map.data + vmeta->offset[0] + y * vmeta->stride[0];
+
+    for (x = 0; x < SPU_WIDTH; x++) {
+      const guint8 *pixel = line + x * 4;
+
+      /* the lookup table entries are grey, so U and V stay at 128 */
+      fail_unless (pixel[0] == 0xff
+          && pixel[1] == default_luma[expected_index (x, y)]
+          && pixel[2] == 0x80 && pixel[3] == 0x80, "pixel %d,%d differs", x,
+          y);
+    }
+  }
+  gst_buffer_unmap (pixels, &map);
+
+  cleanup_dvdsubdec (dvdsubdec);
+}
+
+GST_END_TEST;
+
+static Suite *
+dvdsubdec_suite (void)
+{
+  Suite *s = suite_create ("dvdsubdec");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_decode_rle);
+  tcase_add_test (tc_chain, test_highlight);
+  tcase_add_test (tc_chain, test_unchanged_frame);
+  tcase_add_test (tc_chain, test_render_count);
+  tcase_add_test (tc_chain, test_overlay_composition);
+  return s;
+}
+
+GST_CHECK_MAIN (dvdsubdec);
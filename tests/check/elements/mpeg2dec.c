@@ -21,6 +21,7 @@
  */
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/video/video-info.h>
@@ -1954,6 +1955,375 @@ GST_START_TEST (test_decode_garbage)
 }
 
 GST_END_TEST;
+
+GST_START_TEST (test_decode_flush_release_buffers)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer;
+  GstSegment segment;
+  GList *l;
+  int i, j;
+  guint offset;
+
+  mpeg2dec = setup_mpeg2dec ();
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* decode the stream several times in a row, flushing in between as a seek
+   * would, and make sure the decoder does not keep any output buffer mapped */
+  for (j = 0; j < 8; j++) {
+    offset = 0;
+    for (i = 0; i < G_N_ELEMENTS (test_stream_sizes); i++) {
+      inbuffer =
+          gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (guint8 *) test_stream1 + offset, test_stream_sizes[i], 0,
+          test_stream_sizes[i], NULL, NULL);
+      offset += test_stream_sizes[i];
+      fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    }
+
+    fail_unless_equals_int (g_list_length (buffers), 30);
+
+    fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+    fail_unless (gst_pad_push_event (mysrcpad,
+            gst_event_new_flush_stop (TRUE)));
+    gst_segment_init (&segment, GST_FORMAT_TIME);
+    fail_unless (gst_pad_push_event (mysrcpad,
+            gst_event_new_segment (&segment)));
+
+    /* after a flush, we must hold the only reference to the output */
+    for (l = buffers; l; l = l->next)
+      ASSERT_BUFFER_REFCOUNT (GST_BUFFER (l->data), "outbuffer", 1);
+
+    gst_check_drop_buffers ();
+  }
+
+  cleanup_mpeg2dec (mpeg2dec);
+}
+
+GST_END_TEST;
+
+/* P and B pictures for the 176x144 stream above, without residuals: every
+ * slice codes its first and last macroblock with zero motion and skips the
+ * ones in between. The temporal reference is filled in when sending them */
+static const guint8 test_p_picture[] = {
+  0x00, 0x00, 0x01, 0x00, 0x00, 0x17, 0xff, 0xfb, 0x80,
+  0x00, 0x00, 0x01, 0xb5, 0x81, 0x1f, 0xf3, 0x41, 0x80,
+  0x00, 0x00, 0x01, 0x01, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x02, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x03, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x04, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x05, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x06, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x07, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x08, 0x12, 0x70, 0xb3, 0x80,
+  0x00, 0x00, 0x01, 0x09, 0x12, 0x70, 0xb3, 0x80,
+};
+
+static const guint8 test_b_picture[] = {
+  0x00, 0x00, 0x01, 0x00, 0x00, 0x1f, 0xff, 0xfb, 0xb8,
+  0x00, 0x00, 0x01, 0xb5, 0x81, 0x11, 0x13, 0x41, 0x80,
+  0x00, 0x00, 0x01, 0x01, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x02, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x03, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x04, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x05, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x06, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x07, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x08, 0x13, 0x78, 0x5d, 0xe0,
+  0x00, 0x00, 0x01, 0x09, 0x13, 0x78, 0x5d, 0xe0,
+};
+
+static GstBuffer *
+create_picture (const guint8 * picture, gsize size, guint temporal_ref)
+{
+  GstBuffer *buf;
+  guint8 *data;
+
+  data = g_malloc (size);
+  memcpy (data, picture, size);
+  data[4] = temporal_ref >> 2;
+  data[5] = (data[5] & 0x3f) | ((temporal_ref & 0x3) << 6);
+
+  buf = gst_buffer_new_wrapped (data, size);
+
+  return buf;
+}
+
+GST_START_TEST (test_decode_ibbp)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer, *outbuffer;
+  GstSegment segment;
+  GstClockTime last_pts = GST_CLOCK_TIME_NONE;
+  GList *l;
+  guint i, n_frames;
+
+  mpeg2dec = setup_mpeg2dec ();
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* sequence header, GOP and I picture of the first stream */
+  inbuffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (guint8 *) test_stream1, test_stream_sizes[0], 0, test_stream_sizes[0],
+      NULL, NULL);
+  GST_BUFFER_PTS (inbuffer) = 0;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  n_frames = 1;
+
+  /* coded as I P B B P B B ..., with more pictures than the decoder has
+   * buffer slots so that frame numbers wrap around while references are
+   * still held */
+  for (i = 0; i < 20; i++) {
+    guint p_ref = 3 * i + 3;
+
+    inbuffer = create_picture (test_p_picture, sizeof (test_p_picture), p_ref);
+    GST_BUFFER_PTS (inbuffer) = p_ref * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+
+    inbuffer = create_picture (test_b_picture, sizeof (test_b_picture),
+        p_ref - 2);
+    GST_BUFFER_PTS (inbuffer) = (p_ref - 2) * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+
+    inbuffer = create_picture (test_b_picture, sizeof (test_b_picture),
+        p_ref - 1);
+    GST_BUFFER_PTS (inbuffer) = (p_ref - 1) * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+
+    n_frames += 3;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* every picture comes out, in display order */
+  fail_unless_equals_int (g_list_length (buffers), n_frames);
+  for (l = buffers; l; l = l->next) {
+    outbuffer = GST_BUFFER (l->data);
+    fail_unless_equals_int (gst_buffer_get_size (outbuffer), 38016);
+    if (GST_CLOCK_TIME_IS_VALID (last_pts))
+      fail_unless (GST_BUFFER_PTS (outbuffer) > last_pts);
+    last_pts = GST_BUFFER_PTS (outbuffer);
+  }
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  for (l = buffers; l; l = l->next)
+    ASSERT_BUFFER_REFCOUNT (GST_BUFFER (l->data), "outbuffer", 1);
+
+  gst_check_drop_buffers ();
+  cleanup_mpeg2dec (mpeg2dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_qos_skip)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer, *outbuffer;
+  GstEvent *event;
+  GList *l;
+  int i;
+  guint offset = 0;
+
+  mpeg2dec = setup_mpeg2dec ();
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* pretend downstream is 300ms late already, this is more than the decoder
+   * latency, so everything up to the next keyframe should be skipped */
+  event = gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 1.0, 0,
+      300 * GST_MSECOND);
+  gst_pad_push_event (mysinkpad, event);
+
+  for (i = 0; i < G_N_ELEMENTS (test_stream_sizes); i++) {
+    inbuffer =
+        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (guint8 *) test_stream1 + offset, test_stream_sizes[i], 0,
+        test_stream_sizes[i], NULL, NULL);
+    offset += test_stream_sizes[i];
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  /* the late keyframe is dropped after decoding, the P frames following it
+   * are skipped and decoding resumes with the next keyframe */
+  fail_unless_equals_int (g_list_length (buffers), 15);
+
+  for (l = buffers, i = 15; l; l = l->next, i++) {
+    outbuffer = GST_BUFFER (l->data);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuffer),
+        i * 40 * GST_MSECOND);
+  }
+
+  gst_check_drop_buffers ();
+  cleanup_mpeg2dec (mpeg2dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_keyframes_only)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer;
+  int i;
+  guint offset = 0;
+
+  mpeg2dec = setup_mpeg2dec ();
+  g_object_set (mpeg2dec, "decode-mode", 1, NULL);
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  for (i = 0; i < G_N_ELEMENTS (test_stream_sizes); i++) {
+    inbuffer =
+        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        (guint8 *) test_stream1 + offset, test_stream_sizes[i], 0,
+        test_stream_sizes[i], NULL, NULL);
+    offset += test_stream_sizes[i];
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  /* only the first two keyframes make it out, the last one is still
+   * pending in the decoder */
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffers->data), 0);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffers->next->data),
+      15 * 40 * GST_MSECOND);
+
+  gst_check_drop_buffers ();
+  cleanup_mpeg2dec (mpeg2dec);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_parallel_gops)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer, *outbuffer;
+  guint8 *data;
+  GList *l;
+  int i;
+  guint offset = 0;
+
+  /* mark the GOPs of the test stream as closed, it has no B frames */
+  data = g_malloc (sizeof (test_stream1));
+  memcpy (data, test_stream1, sizeof (test_stream1));
+  for (i = 0; i + 8 <= sizeof (test_stream1); i++) {
+    if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01 &&
+        data[i + 3] == 0xb8)
+      data[i + 7] |= 0x40;
+  }
+
+  mpeg2dec = setup_mpeg2dec ();
+  g_object_set (mpeg2dec, "max-threads", 2, NULL);
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  for (i = 0; i < G_N_ELEMENTS (test_stream_sizes); i++) {
+    inbuffer =
+        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        data + offset, test_stream_sizes[i], 0, test_stream_sizes[i], NULL,
+        NULL);
+    offset += test_stream_sizes[i];
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* every GOP is decoded to the end, so nothing is left in the decoder */
+  fail_unless_equals_int (g_list_length (buffers), 32);
+
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    outbuffer = GST_BUFFER (l->data);
+    fail_unless_equals_int (gst_buffer_get_size (outbuffer), 38016);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuffer),
+        i * 40 * GST_MSECOND);
+  }
+
+  gst_check_drop_buffers ();
+  cleanup_mpeg2dec (mpeg2dec);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_parallel_open_gop)
+{
+  GstElement *mpeg2dec;
+  GstBuffer *inbuffer;
+  guint8 *data;
+  GList *l;
+  int i, j;
+  guint offset = 0;
+
+  data = g_malloc (sizeof (test_stream1));
+  memcpy (data, test_stream1, sizeof (test_stream1));
+
+  mpeg2dec = setup_mpeg2dec ();
+  g_object_set (mpeg2dec, "max-threads", 2, NULL);
+
+  fail_unless (gst_element_set_state (mpeg2dec,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  for (i = 0; i < G_N_ELEMENTS (test_stream_sizes); i++) {
+    guint skip = 0;
+
+    for (j = 0; j + 8 <= test_stream_sizes[i]; j++) {
+      guint8 *p = data + offset + j;
+
+      if (p[0] != 0x00 || p[1] != 0x00 || p[2] != 0x01)
+        continue;
+
+      /* the first GOP is closed, the second one is open and doesn't repeat
+       * the sequence header, so the serial decoder has to take over with
+       * the one seen before */
+      if (p[3] == 0xb8 && i == 0)
+        p[7] |= 0x40;
+      else if (p[3] == 0xb8 && i > 0 && skip == 0 && j > 0)
+        skip = j;
+    }
+
+    inbuffer =
+        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        data + offset + skip, test_stream_sizes[i] - skip, 0,
+        test_stream_sizes[i] - skip, NULL, NULL);
+    offset += test_stream_sizes[i];
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* there are no B pictures to lose when switching */
+  fail_unless_equals_int (g_list_length (buffers), 32);
+  for (l = buffers; l; l = l->next)
+    fail_unless_equals_int (gst_buffer_get_size (GST_BUFFER (l->data)),
+        38016);
+
+  gst_check_drop_buffers ();
+  cleanup_mpeg2dec (mpeg2dec);
+  g_free (data);
+}
+
+GST_END_TEST;
+
 Suite *
 mpeg2dec_suite (void)
 {
@@ -1964,6 +2334,12 @@ mpeg2dec_suite (void)
   tcase_add_test (tc_chain, test_decode_stream1);
   tcase_add_test (tc_chain, test_decode_stream2);
   tcase_add_test (tc_chain, test_decode_garbage);
+  tcase_add_test (tc_chain, test_decode_flush_release_buffers);
+  tcase_add_test (tc_chain, test_decode_ibbp);
+  tcase_add_test (tc_chain, test_decode_qos_skip);
+  tcase_add_test (tc_chain, test_decode_keyframes_only);
+  tcase_add_test (tc_chain, test_decode_parallel_gops);
+  tcase_add_test (tc_chain, test_decode_parallel_open_gop);
 
   return s;
 }